@@ -0,0 +1,12 @@
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeTnPRecord.h>
+
+#ifdef __CINT__
+
+#pragma link off all globals;
+#pragma link off all classes;
+#pragma link off all functions;
+
+#pragma link C++ class TnPRecord+;
+#pragma link C++ class std::vector<TnPRecord>+;
+
+#endif
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <TH1D.h>
+
+#include <UHH2/core/include/Event.h>
+#include <UHH2/core/include/Selection.h>
+#include <UHH2/core/include/Hists.h>
+
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeProductScheduler.h>
+
+/** \brief per-step counters of a Cutflow
+ *
+ *  -- bin 1: events entering the cutflow, bin i+1: events passing step i (bin labels = step names)
+ *  -- "cutflow_raw": unweighted counts, "cutflow_wgt": sum of event weights
+ *  -- "cutflow_time" (booked only if timing): time spent in the step, i.e. in the products it triggers and in Selection::passes [s]
+ */
+class CutflowHists : public uhh2::Hists {
+
+ public:
+  explicit CutflowHists(uhh2::Context&, const std::string&, const std::vector<std::string>&, const bool timing=false);
+  virtual void fill(const uhh2::Event&) override {}
+
+  void count(const size_t, const double);
+  void time (const size_t, const double);
+
+  bool timing() const { return cutflow_time != 0; }
+
+  /* clear all the counters and set the bin labels of the steps (new step order) */
+  void reset(const std::vector<std::string>&);
+
+ protected:
+  TH1D* cutflow_raw;
+  TH1D* cutflow_wgt;
+  TH1D* cutflow_time;
+};
+
+/** \brief ordered list of (name, Selection, optional Hists) steps evaluated with short-circuiting
+ *
+ *  -- steps are added in code with add(); Cutflow takes ownership of Selection and Hists
+ *  -- finalize(ctx) reads the optional UserConfig item "<name>__steps" (comma-separated step names)
+ *     to reorder (or drop) the steps, and books the CutflowHists in the directory "<name>"
+ *  -- process(event) returns false at the first failing step; the Hists of every passed step are filled
+ *  -- optional ProductScheduler: each step declares the products needed by its Selection and by its Hists,
+ *     which are produced lazily right before the Selection is evaluated (resp. the Hists are filled)
+ *  -- optional timing (UserConfig item "<name>__timing" = "true"): time of each step in "cutflow_time",
+ *     including the products produced on its request (charged to the first step requiring them)
+ *
+ *  -- adaptive mode (UserConfig item "<name>__adaptive" = N > 0), for blocks of commutative, side-effect-free steps:
+ *   * the first N events evaluate all the steps, measuring per event the time of each Selection, the time of each product
+ *     (ProductScheduler timing, products already available when the cutflow starts cost nothing) and the step results
+ *   * cost model: a candidate order is replayed on the training events, short-circuited at the first failing step,
+ *     each product being paid once by the first step requiring it (directly or through its dependencies) in that order;
+ *     the order with the minimal expected cost per event is chosen (all orders for up to 7 steps, greedy search beyond)
+ *   * at the reordering, the CutflowHists are relabelled in the new order and the training events recounted in it
+ *     (per-step results and times of the training events kept until then): the counters always refer to one step order
+ *   * the final acceptance does not depend on the order; the order-dependent intermediate Hists are disabled,
+ *     only the Hists of the last configured step are filled (events passing all the steps)
+ *   * the order depends on the training events and on the measured times: to be run as one single-process training job,
+ *     the chosen order is logged as an xml item "<name>__steps" to be used in the production jobs
+ *     (otherwise each PROOF worker chooses its own order, and the merged counters mix different step orders)
+ */
+class Cutflow {
+
+ public:
+  explicit Cutflow(const std::string& name, ProductScheduler* products=0): name_(name), products_(products) {}
+
+  void add(const std::string&, std::unique_ptr<uhh2::Selection>, std::unique_ptr<uhh2::Hists> hists=std::unique_ptr<uhh2::Hists>(),
+           const std::vector<std::string>& sel_products=std::vector<std::string>(), const std::vector<std::string>& hists_products=std::vector<std::string>());
+  void finalize(uhh2::Context&);
+
+  bool process(uhh2::Event&);
+  bool adaptive() const { return adaptive_nevents_ > 0; }
+
+  const std::string& name() const { return name_; }
+
+ protected:
+  bool process_training(uhh2::Event&);
+  void reorder();
+
+  /* time charged to step i for training event e, products flagged in 'paid' excluded (and flagged as paid) */
+  double train_cost(const size_t e, const size_t i, std::vector<char>& paid) const;
+
+  struct Step {
+
+    std::string name;
+    int bin; // bin of the step in the CutflowHists (fixed by the configured order)
+    std::unique_ptr<uhh2::Selection> sel;
+    std::unique_ptr<uhh2::Hists>     hists;
+    std::vector<size_t> sel_products, hists_products;
+    std::vector<size_t> sel_closure; // sel_products and their dependencies (adaptive mode)
+  };
+
+  void require(uhh2::Event&, const std::vector<size_t>&);
+
+  std::string name_;
+  ProductScheduler* products_;
+  std::vector<Step> steps_;
+
+  std::unique_ptr<CutflowHists> counters_;
+
+  // adaptive mode (training results stored per event, step-major in the configured order)
+  size_t adaptive_nevents_ = 0, adaptive_count_ = 0;
+  std::vector<double> train_weight_;
+  std::vector<double> train_time_;  // Selection only
+  std::vector<char>   train_pass_;
+  std::vector<double> train_ptime_; // per product id, event-major
+  uhh2::Hists* final_hists_ = 0;
+  std::vector<size_t> final_hists_products_;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <UHH2/core/include/AnalysisModule.h>
+#include <UHH2/core/include/Event.h>
+
+/** \brief contiguous (structure-of-arrays) kinematics of one particle collection
+ *         (entries keep the ordering of the source collection)
+ */
+struct ParticleArrays {
+
+  std::vector<float> pt, eta, phi, m, charge;
+
+  size_t size() const { return eta.size(); }
+
+  void clear();
+
+  template<typename T>
+  void fill(const std::vector<T>&);
+
+  /* eta and phi only (pt, m, charge left empty): input of the DeltaR kernels */
+  template<typename T>
+  void fill_angles(const std::vector<T>&);
+};
+
+template<typename T>
+void ParticleArrays::fill(const std::vector<T>& coll){
+
+  clear();
+
+  for(const auto& p : coll){
+
+    pt    .push_back(p.pt());
+    eta   .push_back(p.eta());
+    phi   .push_back(p.phi());
+    m     .push_back(p.v4().M());
+    charge.push_back(p.charge());
+  }
+
+  return;
+}
+
+template<typename T>
+void ParticleArrays::fill_angles(const std::vector<T>& coll){
+
+  clear();
+
+  eta.reserve(coll.size());
+  phi.reserve(coll.size());
+  for(const auto& p : coll){
+
+    eta.push_back(p.eta());
+    phi.push_back(p.phi());
+  }
+
+  return;
+}
+////
+
+/** \brief per-event SoA view of the (cleaned) collections used in the Z'->ttbar selection
+ *
+ *  -- built by ZprimeEventViewProducer; to be refreshed after every step modifying the input collections
+ *  -- read by cleaners, cuts and hists in place of the Lorentz-vector accessors of the uhh2 collections
+ */
+struct ZprimeEventView {
+
+  ParticleArrays muons, electrons, jets, topjets;
+
+  float met_pt, met_phi;
+
+  unsigned long long id = 0; // content identifier set by ZprimeEventViewProducer (0: view built locally)
+
+  void fill(const uhh2::Event&);
+
+  /* leptons and MET only (empty jets/topjets): no dependence on the jet corrections and cleaning */
+  void fill_leptons(const uhh2::Event&);
+};
+
+class ZprimeEventViewProducer : public uhh2::AnalysisModule {
+
+ public:
+  explicit ZprimeEventViewProducer(uhh2::Context&, const std::string& label="ZprimeEventView", const bool jets=true);
+  virtual bool process(uhh2::Event&) override;
+
+ private:
+  uhh2::Event::Handle<ZprimeEventView> h_view_;
+  bool jets_;
+  ZprimeEventView view_;
+  unsigned long long nfills_;
+};
+////
+
+float delta_phi(const float, const float);
+
+/* pt-leading charged lepton of the view: (collection, index) [collection is null if the event has no leptons] */
+std::pair<const ParticleArrays*, size_t> leading_lepton(const ZprimeEventView&);
+
+/* pTrel of a particle (pt, eta, phi) wrt a jet axis (eta, phi) */
+float pTrel(const float, const float, const float, const float jet_eta, const float jet_phi);
+
+/* (minDR, pTrel) of a particle (pt, eta, phi) wrt its closest entry in 'jets' [same as drmin_pTrel(Particle, std::vector<Jet>)] */
+std::pair<float, float> drmin_pTrel(const float, const float, const float, const ParticleArrays& jets);
+
+/* minimum DeltaR of a particle (eta, phi) wrt the entries of 'coll' [infinity for empty collection] */
+float drmin(const float, const float, const ParticleArrays& coll);
+
+/** \brief jet multiplicities and lepton-jet (minDR, pTrel) for a list of jet working points (pt > pt_min && |eta| < eta_max),
+ *         computed in a single sweep over the jets
+ *
+ *  -- same result as JetCleaner(pt_min, eta_max) + drmin_pTrel(lepton, jets) for each working point,
+ *     without modifying (or re-sorting) the jet collection; working points not required to be nested
+ *  -- minDR/pTrel indexed by (lepton index in 'leptons', working point index): (999, 999) if no jet passes the working point
+ */
+class JetWorkingPointSweep {
+
+ public:
+  explicit JetWorkingPointSweep(const std::vector<std::pair<float, float>>& wps);
+
+  void run(const ParticleArrays& jets, const ParticleArrays& leptons);
+
+  size_t size() const { return wps_.size(); }
+
+  int   njets(const size_t wp) const { return njets_.at(wp); }
+  float minDR(const size_t lep, const size_t wp) const { return minDR_.at(lep*wps_.size()+wp); }
+  float pTrel(const size_t lep, const size_t wp) const { return pTrel_.at(lep*wps_.size()+wp); }
+
+ private:
+  std::vector<std::pair<float, float>> wps_; // (pt_min, eta_max)
+
+  std::vector<int> njets_;
+  std::vector<float> drmin2_, minDR_, pTrel_;
+  std::vector<size_t> closest_;
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <UHH2/core/include/AnalysisModule.h>
+#include <UHH2/core/include/Event.h>
+#include <UHH2/core/include/LorentzVector.h>
+
+#include <UHH2/common/include/ReconstructionHypothesis.h>
+
+/* float rounded to nearest with 'bits' explicit mantissa bits (0-23) */
+float truncate_mantissa(const float, const int bits);
+
+/* IEEE-754 half precision (round to nearest even, overflow to inf) */
+uint16_t float_to_half(const float);
+float    half_to_float(const uint16_t);
+
+/** \brief storage precision of the flat-ntuple columns, from a comma-separated list of "variable:precision"
+ *
+ *  -- precision: "full" (float), "mN" (float with N mantissa bits, better compression) or "f16" (half precision, 2 bytes)
+ *  -- variable: column suffix (pt, eta, phi, m, charge, btag) applied to all the collections, or "discriminator" (hypothesis discriminators)
+ *     (e.g. "pt:m10,m:m10,eta:f16,phi:f16"); unlisted variables stored in full precision
+ */
+class FlatPrecision {
+
+ public:
+  enum type { full, mantissa, half };
+
+  struct Spec {
+
+    type t = full;
+    int bits = 23;
+  };
+
+  explicit FlatPrecision(const std::string& cfg="");
+
+  const Spec& get(const std::string& var) const;
+
+ protected:
+  std::map<std::string, Spec> specs_;
+  Spec default_;
+};
+
+/** \brief one column of the flat ntuple: vector<float>, or vector<uint16_t> for half precision (branch name with suffix "__f16") */
+class FlatColumn {
+
+ public:
+  explicit FlatColumn(uhh2::Context&, const std::string& name, const FlatPrecision::Spec&, const bool output);
+
+  /* quantize and write (output column) */
+  void put(uhh2::Event&, const std::vector<float>&);
+
+  /* read and decode (input column) */
+  const std::vector<float>& get(const uhh2::Event&);
+
+ protected:
+  FlatPrecision::Spec spec_;
+
+  uhh2::Event::Handle<std::vector<float>>    h_float_;
+  uhh2::Event::Handle<std::vector<uint16_t>> h_half_;
+
+  std::vector<float>    buf_;
+  std::vector<uint16_t> half_;
+};
+
+/** \brief kinematic columns of a particle collection: "<prefix>__pt", "__eta", "__phi", "__m" and (optional) "__charge" */
+class FlatParticleColumns {
+
+ public:
+  explicit FlatParticleColumns(uhh2::Context&, const std::string& prefix, const FlatPrecision&, const bool output, const bool charge=false);
+
+  void clear();
+  void add(const LorentzVector&, const float charge=0.);
+  void put(uhh2::Event&);
+
+  /* number of entries of the current event (input), after get() */
+  size_t get(const uhh2::Event&);
+  LorentzVector v4(const size_t i) const;
+  float charge(const size_t i) const { return charge_ ? charge_vals_->at(i) : 0.; }
+
+ protected:
+  std::unique_ptr<FlatColumn> pt_, eta_, phi_, m_, charge_;
+
+  std::vector<float> pt_buf_, eta_buf_, phi_buf_, m_buf_, charge_buf_;
+  const std::vector<float> *pt_vals_, *eta_vals_, *phi_vals_, *m_vals_, *charge_vals_;
+};
+////
+
+/** \brief flat, quantized ntuple of the Selection output, with the content read by ZprimePostSelectionModule
+ *
+ *  -- columns "flat__<collection>__<variable>":
+ *     muons, electrons (pt, eta, phi, m, charge), jets (pt, eta, phi, m, btag [CSV]), topjets (pt, eta, phi, m),
+ *     met (pt, phi), pvN, ttbar hypotheses (lepton, neutrino, tophad, toplep four-vectors, discriminators,
+ *     hadronic/leptonic jets flattened with per-hypothesis counts "__n")
+ *  -- per-column precision: see FlatPrecision (same configuration to be used by the FlatNtupleReader)
+ *  -- event weight and generator information not included (genInfo branch kept in the output)
+ */
+class FlatNtupleWriter : public uhh2::AnalysisModule {
+
+ public:
+  explicit FlatNtupleWriter(uhh2::Context&, const std::string& hyps, const FlatPrecision&, const std::vector<std::string>& discriminators);
+  virtual bool process(uhh2::Event&) override;
+
+ protected:
+  FlatParticleColumns muons_, electrons_, jets_, topjets_;
+  FlatParticleColumns hyp_lepton_, hyp_neutrino_, hyp_tophad_, hyp_toplep_, hyp_tophad_jets_, hyp_toplep_jets_;
+  std::unique_ptr<FlatColumn> jets_btag_, met_pt_, met_phi_, pvN_, hyp_tophad_jets_n_, hyp_toplep_jets_n_;
+  std::vector<std::unique_ptr<FlatColumn>> hyp_disc_;
+
+  std::vector<std::string> discriminators_;
+  uhh2::Event::Handle<std::vector<ReconstructionHypothesis>> h_hyps_;
+
+  std::vector<float> buf_;
+};
+
+/** \brief reader of the FlatNtupleWriter columns
+ *
+ *  -- collections rebuilt in module-owned vectors and attached to the event (event.muons, electrons, jets, topjets, met, pvs):
+ *     the uhh2 input collections must not be read (collection names of the xml file left empty)
+ *  -- ttbar hypotheses written to the event handle 'hyps'
+ *  -- variables not stored in the flat ntuple are default-initialized (e.g. jet substructure, lepton isolation)
+ */
+class FlatNtupleReader : public uhh2::AnalysisModule {
+
+ public:
+  explicit FlatNtupleReader(uhh2::Context&, const std::string& hyps, const FlatPrecision&, const std::vector<std::string>& discriminators);
+  virtual bool process(uhh2::Event&) override;
+
+ protected:
+  FlatParticleColumns muons_, electrons_, jets_, topjets_;
+  FlatParticleColumns hyp_lepton_, hyp_neutrino_, hyp_tophad_, hyp_toplep_, hyp_tophad_jets_, hyp_toplep_jets_;
+  std::unique_ptr<FlatColumn> jets_btag_, met_pt_, met_phi_, pvN_, hyp_tophad_jets_n_, hyp_toplep_jets_n_;
+  std::vector<std::unique_ptr<FlatColumn>> hyp_disc_;
+
+  std::vector<std::string> discriminators_;
+  uhh2::Event::Handle<std::vector<ReconstructionHypothesis>> h_hyps_;
+
+  std::vector<Muon>          muons;
+  std::vector<Electron>      electrons;
+  std::vector<Jet>           jets;
+  std::vector<TopJet>        topjets;
+  MET                        met;
+  std::vector<PrimaryVertex> pvs;
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <TH1.h>
+
+#include <UHH2/core/include/AnalysisModule.h>
+#include <UHH2/core/include/Hists.h>
+#include <UHH2/core/include/Event.h>
+
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeEventView.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeSemiLeptonicUtils.h>
+
+/** \brief per-event record of the variables of the Zprime hist sets, computed once per content of a ZprimeEventView
+ *
+ *  -- val[i] defined only if set[i] (e.g. 2nd-muon variables only for events with >=2 muons)
+ *  -- view_id: id of the ZprimeEventView the record was computed from
+ */
+struct ZprimeEventVars {
+
+  enum index {
+
+    weight, pvN,
+    muoN, muo1__pt, muo1__eta, muo1__minDR_jet, muo1__pTrel_jet, muo1__minDR_topjet,
+          muo2__pt, muo2__eta, muo2__minDR_jet, muo2__pTrel_jet, muo2__minDR_topjet,
+    eleN, ele1__pt, ele1__eta, ele1__minDR_jet, ele1__pTrel_jet, ele1__minDR_topjet,
+          ele2__pt, ele2__eta, ele2__minDR_jet, ele2__pTrel_jet, ele2__minDR_topjet,
+    jetN, jet1__pt, jet1__eta, jet2__pt, jet2__eta, jet3__pt, jet3__eta,
+    topjetN, topjet1__pt, topjet1__eta, topjet2__pt, topjet2__eta,
+    met__pt, met__phi, htlep__pt, dphi_met_lep1, dphi_met_jet1,
+    nvars
+  };
+
+  double val[nvars];
+  bool  set[nvars];
+
+  unsigned long long view_id;
+
+  /* LeptonSummary optional (leading lepton taken from the view if null) */
+  void fill(const uhh2::Event&, const ZprimeEventView&, const LeptonSummary*);
+
+  /* variable computed from the jets/topjets of the view (meaningless for a lepton-only view) */
+  static bool jet_dependent(const int);
+};
+
+class ZprimeEventVarsProducer : public uhh2::AnalysisModule {
+
+ public:
+  explicit ZprimeEventVarsProducer(uhh2::Context&, const std::string& view="ZprimeEventView", const std::string& lepsum="LeptonSummary");
+  virtual bool process(uhh2::Event&) override;
+
+ private:
+  uhh2::Event::Handle<ZprimeEventView> h_view_;
+  uhh2::Event::Handle<LeptonSummary>   h_lepsum_;
+  uhh2::Event::Handle<ZprimeEventVars> h_vars_;
+
+  ZprimeEventVars vars_;
+};
+////
+
+/** \brief histogram descriptor: 1D (nbinsy == 0) or 2D histogram of ZprimeEventVars variables
+ *
+ *  -- weighted: filled with the event weight (false: unit weight)
+ *  -- lep2: histogram of the 2nd muon/electron (not booked in the PostSelection hists)
+ */
+struct ZprimeHistDescriptor {
+
+  const char* name;
+  const char* title;
+  int nbinsx; float xmin, xmax; int varx;
+  int nbinsy; float ymin, ymax; int vary;
+  bool weighted;
+  bool lep2;
+};
+
+constexpr ZprimeHistDescriptor zprime_hists[] = {
+
+  {"weight"            , ";event weight"                   , 120,   -6,    6, ZprimeEventVars::weight            ,  0, 0,   0, 0                               , false, false},
+
+  // PV
+  {"pvN"               , ";# of primary vertices"          ,  60,    0,   60, ZprimeEventVars::pvN               ,  0, 0,   0, 0                               , true , false},
+
+  // MUON
+  {"muoN"              , ";# of muons"                     ,  20,    0,   20, ZprimeEventVars::muoN              ,  0, 0,   0, 0                               , true , false},
+  {"muo1__pt"          , ";muon p_{T} [GeV]"               , 240,    0, 1200, ZprimeEventVars::muo1__pt          ,  0, 0,   0, 0                               , true , false},
+  {"muo1__eta"         , ";muon #eta"                      ,  60,   -3,    3, ZprimeEventVars::muo1__eta         ,  0, 0,   0, 0                               , true , false},
+  {"muo1__minDR_jet"   , ";#DeltaR_{min}(#mu, jet)"        ,  60,    0,    6, ZprimeEventVars::muo1__minDR_jet   ,  0, 0,   0, 0                               , true , false},
+  {"muo1__pTrel_jet"   , ";p_{T, rel}(#mu, jet)"           , 180,    0,  180, ZprimeEventVars::muo1__pTrel_jet   ,  0, 0,   0, 0                               , true , false},
+  {"muo1__minDR_topjet", ";#DeltaR_{min}(#mu, topjet)"     ,  60,    0,    6, ZprimeEventVars::muo1__minDR_topjet,  0, 0,   0, 0                               , true , false},
+  {"muo2__pt"          , ";muon p_{T} [GeV]"               , 240,    0, 1200, ZprimeEventVars::muo2__pt          ,  0, 0,   0, 0                               , true , true },
+  {"muo2__eta"         , ";muon #eta"                      ,  60,   -3,    3, ZprimeEventVars::muo2__eta         ,  0, 0,   0, 0                               , true , true },
+  {"muo2__minDR_jet"   , ";#DeltaR_{min}(#mu, jet)"        ,  60,    0,    6, ZprimeEventVars::muo2__minDR_jet   ,  0, 0,   0, 0                               , true , true },
+  {"muo2__pTrel_jet"   , ";p_{T, rel}(#mu, jet)"           , 180,    0,  180, ZprimeEventVars::muo2__pTrel_jet   ,  0, 0,   0, 0                               , true , true },
+  {"muo2__minDR_topjet", ";#DeltaR_{min}(#mu, topjet)"     ,  60,    0,    6, ZprimeEventVars::muo2__minDR_topjet,  0, 0,   0, 0                               , true , true },
+
+  // ELECTRON
+  {"eleN"              , ";# of electrons"                 ,  20,    0,   20, ZprimeEventVars::eleN              ,  0, 0,   0, 0                               , true , false},
+  {"ele1__pt"          , ";electron p_{T} [GeV]"           , 240,    0, 1200, ZprimeEventVars::ele1__pt          ,  0, 0,   0, 0                               , true , false},
+  {"ele1__eta"         , ";electron #eta"                  ,  60,   -3,    3, ZprimeEventVars::ele1__eta         ,  0, 0,   0, 0                               , true , false},
+  {"ele1__minDR_jet"   , ";#DeltaR_{min}(e, jet)"          ,  60,    0,    6, ZprimeEventVars::ele1__minDR_jet   ,  0, 0,   0, 0                               , true , false},
+  {"ele1__pTrel_jet"   , ";p_{T, rel}(e, jet)"             , 180,    0,  180, ZprimeEventVars::ele1__pTrel_jet   ,  0, 0,   0, 0                               , true , false},
+  {"ele1__minDR_topjet", ";#DeltaR_{min}(e, topjet)"       ,  60,    0,    6, ZprimeEventVars::ele1__minDR_topjet,  0, 0,   0, 0                               , true , false},
+  {"ele2__pt"          , ";electron p_{T} [GeV]"           , 240,    0, 1200, ZprimeEventVars::ele2__pt          ,  0, 0,   0, 0                               , true , true },
+  {"ele2__eta"         , ";electron #eta"                  ,  60,   -3,    3, ZprimeEventVars::ele2__eta         ,  0, 0,   0, 0                               , true , true },
+  {"ele2__minDR_jet"   , ";#DeltaR_{min}(e, jet)"          ,  60,    0,    6, ZprimeEventVars::ele2__minDR_jet   ,  0, 0,   0, 0                               , true , true },
+  {"ele2__pTrel_jet"   , ";p_{T, rel}(e, jet)"             , 180,    0,  180, ZprimeEventVars::ele2__pTrel_jet   ,  0, 0,   0, 0                               , true , true },
+  {"ele2__minDR_topjet", ";#DeltaR_{min}(e, topjet)"       ,  60,    0,    6, ZprimeEventVars::ele2__minDR_topjet,  0, 0,   0, 0                               , true , true },
+
+  // JET
+  {"jetN"              , ";# of jets"                      ,  20,    0,   20, ZprimeEventVars::jetN              ,  0, 0,   0, 0                               , true , false},
+  {"jet1__pt"          , ";jet p_{T} [GeV]"                , 180,    0, 1800, ZprimeEventVars::jet1__pt          ,  0, 0,   0, 0                               , true , false},
+  {"jet1__eta"         , ";jet #eta"                       ,  60,   -3,    3, ZprimeEventVars::jet1__eta         ,  0, 0,   0, 0                               , true , false},
+  {"jet2__pt"          , ";jet p_{T} [GeV]"                , 180,    0, 1800, ZprimeEventVars::jet2__pt          ,  0, 0,   0, 0                               , true , false},
+  {"jet2__eta"         , ";jet #eta"                       ,  60,   -3,    3, ZprimeEventVars::jet2__eta         ,  0, 0,   0, 0                               , true , false},
+  {"jet3__pt"          , ";jet p_{T} [GeV]"                , 180,    0, 1800, ZprimeEventVars::jet3__pt          ,  0, 0,   0, 0                               , true , false},
+  {"jet3__eta"         , ";jet #eta"                       ,  60,   -3,    3, ZprimeEventVars::jet3__eta         ,  0, 0,   0, 0                               , true , false},
+
+  // TOPJET
+  {"topjetN"           , ";# of topjets"                   ,  20,    0,   20, ZprimeEventVars::topjetN           ,  0, 0,   0, 0                               , true , false},
+  {"topjet1__pt"       , ";topjet p_{T} [GeV]"             , 180,    0, 1800, ZprimeEventVars::topjet1__pt       ,  0, 0,   0, 0                               , true , false},
+  {"topjet1__eta"      , ";topjet #eta"                    ,  60,   -3,    3, ZprimeEventVars::topjet1__eta      ,  0, 0,   0, 0                               , true , false},
+  {"topjet2__pt"       , ";topjet p_{T} [GeV]"             , 180,    0, 1800, ZprimeEventVars::topjet2__pt       ,  0, 0,   0, 0                               , true , false},
+  {"topjet2__eta"      , ";topjet #eta"                    ,  60,   -3,    3, ZprimeEventVars::topjet2__eta      ,  0, 0,   0, 0                               , true , false},
+
+  // MET
+  {"met__pt"           , ";MET [GeV]"                      , 180,    0, 1800, ZprimeEventVars::met__pt           ,  0, 0,   0, 0                               , true , false},
+  {"met__phi"          , ";MET #phi"                       ,  72, -3.6,  3.6, ZprimeEventVars::met__phi          ,  0, 0,   0, 0                               , true , false},
+  {"htlep__pt"         , ";H_{T}^{lep} [GeV]"              , 180,    0, 1800, ZprimeEventVars::htlep__pt         ,  0, 0,   0, 0                               , true , false},
+  {"met_VS_dphi_lep1"  , ";MET [GeV];#Delta#phi(MET, l1)"  , 180,    0, 1800, ZprimeEventVars::met__pt           , 60, 0, 3.6, ZprimeEventVars::dphi_met_lep1  , true , false},
+  {"met_VS_dphi_jet1"  , ";MET [GeV];#Delta#phi(MET, l1)"  , 180,    0, 1800, ZprimeEventVars::met__pt           , 60, 0, 3.6, ZprimeEventVars::dphi_met_jet1  , true , false},
+};
+
+/* bin of x on a uniform axis (0: underflow, n+1: overflow and NaN), same as TAxis::FindFixBin */
+inline int zprime_fixbin(const double x, const int n, const double xmin, const double xmax){
+
+  if(x < xmin)     return 0;
+  if(!(x < xmax))  return n+1;
+
+  return 1 + int(n*(x-xmin)/(xmax-xmin));
+}
+
+/** \brief table-driven Zprime hist set (histograms booked from zprime_hists)
+ *
+ *  -- variables read from the ZprimeEventVars product of the given view (if computed from the current view content),
+ *     otherwise computed locally: stages seeing the same event content only do the binning and the fills
+ *  -- fills written directly in the arrays of the booked TH1F/TH2F (one inline bin lookup, no virtual TH1::Fill):
+ *     bin contents, sum of squared weights (booked for the weighted hists) and entries updated at every fill,
+ *     stats computed by ROOT from the bin contents; the histograms must not be rebinned
+ *  -- jets == false: histograms of jet-dependent variables not booked (stages filled before the jet reconstruction,
+ *     to be used with a lepton-only view, see ZprimeEventView::fill_leptons)
+ */
+class ZprimeTableHists : public uhh2::Hists {
+
+ public:
+  explicit ZprimeTableHists(uhh2::Context&, const std::string&, const bool lep2, const std::string& view, const std::string& lepsum, const bool jets=true);
+  virtual void fill(const uhh2::Event&) override;
+
+ protected:
+  uhh2::Event::Handle<ZprimeEventView> h_view_;
+  uhh2::Event::Handle<LeptonSummary>   h_lepsum_;
+  uhh2::Event::Handle<ZprimeEventVars> h_vars_;
+
+  bool jets_;
+
+  ZprimeEventView view_; // built locally if the event product is not available
+  ZprimeEventVars vars_;
+
+  struct Target {
+
+    const ZprimeHistDescriptor* d;
+    TH1* h;
+    float*  sumw;  // bin contents (global bin index)
+    double* sumw2; // null if no Sumw2
+  };
+
+  std::vector<Target> hists_; // booked histograms only
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <UHH2/core/include/Event.h>
+
+/** \brief lazy, dependency-aware evaluation of per-event products (object cleaning, corrections, views)
+ *
+ *  -- each product is a named producer function and the list of products it depends on;
+ *     dependencies must be added before the products using them (no cycles by construction)
+ *  -- require(event, product): runs the missing dependencies and then the producer, at most once per event
+ *  -- reset() has to be called at the beginning of every event
+ *  -- optional timing of the producers (enabled while at least one client requested it, see time_producers):
+ *     time(product) is the time of the producer itself in the current event (dependencies excluded, 0 if not produced)
+ */
+class ProductScheduler {
+
+ public:
+  typedef std::function<void(uhh2::Event&)> Producer;
+
+  void add(const std::string&, const Producer&, const std::vector<std::string>& deps=std::vector<std::string>());
+
+  size_t id(const std::string&) const;
+
+  void require(uhh2::Event&, const size_t);
+  void require(uhh2::Event& event, const std::string& name){ require(event, id(name)); }
+
+  bool done(const std::string& name) const { return products_.at(id(name)).done; }
+  bool done(const size_t i) const { return products_.at(i).done; }
+
+  size_t size() const { return products_.size(); }
+
+  /* products and their (recursive) dependencies: flag per product id */
+  std::vector<char> closure(const std::vector<size_t>&) const;
+
+  void time_producers(const bool on){ timing_ += on ? 1 : -1; }
+  double time(const size_t i) const { return products_.at(i).time; }
+
+  void reset();
+
+ protected:
+  struct Product {
+
+    std::string name;
+    Producer producer;
+    std::vector<size_t> deps;
+    bool done;
+    double time;
+  };
+
+  std::vector<Product> products_;
+  int timing_ = 0;
+};
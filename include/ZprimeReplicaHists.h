@@ -0,0 +1,139 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <TH1.h>
+
+#include <UHH2/core/include/AnalysisModule.h>
+#include <UHH2/core/include/Hists.h>
+#include <UHH2/core/include/Event.h>
+
+#include <UHH2/common/include/ReconstructionHypothesis.h>
+
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeEventView.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeHistVars.h>
+
+/** \brief per-event weights of N replicas (event weight times the replica factor) */
+struct ReplicaWeights {
+
+  std::vector<double> w;
+};
+
+/** \brief producer of the ReplicaWeights of the event
+ *
+ *  -- mode "bootstrap": N Poisson(1) factors, deterministic (seeded by run, lumi block, event number and replica index)
+ *  -- mode "systweights": N generator weights genInfo->systweights()[first, first+N) normalized to originalXWGTUP (PDF, muR/muF)
+ */
+class ReplicaWeightsProducer : public uhh2::AnalysisModule {
+
+ public:
+  explicit ReplicaWeightsProducer(uhh2::Context&, const std::string& label, const std::string& mode, const int nreplicas, const int first=0);
+  virtual bool process(uhh2::Event&) override;
+
+ protected:
+  enum mode { bootstrap, systweights };
+  mode mode_;
+
+  int nreplicas_;
+  int first_;
+
+  uhh2::Event::Handle<ReplicaWeights> h_weights_;
+  ReplicaWeights weights_;
+};
+////
+
+/** \brief uniform-binning 1D histogram of N weight replicas: one bin lookup per fill, replica weights added directly to the output histograms
+ *
+ *  -- output: one TH2D (replica, x bin) or N TH1D "<name>__rep<i>", booked with the final binning and Sumw2:
+ *     bin contents and sum of squared weights updated in the ROOT arrays at every fill (output complete at any time, no end-of-job step)
+ *  -- TH2D booked with the replica on the x axis: the N replica cells of one observable bin are contiguous in the ROOT arrays
+ *  -- stats computed by ROOT from the bin contents (no Fill call); the targets must not be rebinned
+ */
+class ReplicaHist {
+
+ public:
+  explicit ReplicaHist(const std::vector<TH1*>& targets, const int nx, const double xmin, const double xmax, const int nreplicas);
+
+  void fill(const double x, const double* w){
+
+    const int b = fixbin(x, nx_, xmin_, xmax_);
+
+    if(output_2d_){
+
+      // cells (replica 1..N, y bin b): offset (N+2)*b + 1 + r
+      double* sumw  = sumw_ [0] + size_t(nrep_+2)*b + 1;
+      double* sumw2 = sumw2_[0] + size_t(nrep_+2)*b + 1;
+
+      for(int r=0; r<nrep_; ++r){
+
+        sumw [r] += w[r];
+        sumw2[r] += w[r]*w[r];
+      }
+    }
+    else {
+
+      for(int r=0; r<nrep_; ++r){
+
+        sumw_ [r][b] += w[r];
+        sumw2_[r][b] += w[r]*w[r];
+      }
+    }
+
+    for(auto* t : targets_) t->SetEntries(t->GetEntries() + entries_step_);
+  }
+
+  static int fixbin(const double x, const int n, const double xmin, const double xmax){ return zprime_fixbin(x, n, xmin, xmax); }
+
+ protected:
+  std::vector<TH1*> targets_;
+
+  int nx_;
+  double xmin_, xmax_;
+  int nrep_;
+  bool output_2d_;
+  double entries_step_; // entries per fill and target (2D output: one per replica)
+
+  // bin contents and sum of squared weights (pointers into the arrays of the targets): one per TH1D target, full array of the TH2D target
+  std::vector<double*> sumw_, sumw2_;
+};
+////
+
+/** \brief weight-replica versions of the Zprime hist set (1D weighted histograms of zprime_hists)
+ *         and of the mass/discriminator of the best ttbar hypothesis
+ *
+ *  -- weights from the ReplicaWeights product, variables from the ZprimeEventVars product (computed locally if not available)
+ *  -- XML option "replicas__output": "2d" (default, one replica x bin TH2D per variable) or "1d" (N TH1D per variable)
+ *  -- of the HypothesisHists set, only M_ttbar and the discriminator of the best hypothesis are replicated
+ *     (top-quark masses/pts and the other hypothesis observables not covered)
+ */
+class ZprimeReplicaHists : public uhh2::Hists {
+
+ public:
+  explicit ZprimeReplicaHists(uhh2::Context&, const std::string&, const std::string& weights, const int nreplicas, const bool lep2,
+                              const std::string& hyps, const std::string& discriminator,
+                              const std::string& view="ZprimeEventView", const std::string& lepsum="LeptonSummary");
+  virtual void fill(const uhh2::Event&) override;
+
+ protected:
+  std::unique_ptr<ReplicaHist> book_replicas(const std::string&, const std::string&, const int, const double, const double);
+
+  uhh2::Event::Handle<ReplicaWeights> h_weights_;
+  uhh2::Event::Handle<ZprimeEventView> h_view_;
+  uhh2::Event::Handle<LeptonSummary>   h_lepsum_;
+  uhh2::Event::Handle<ZprimeEventVars> h_vars_;
+  uhh2::Event::Handle<std::vector<ReconstructionHypothesis>> h_hyps_;
+  uhh2::Event::Handle<BestHypothesis> h_best_;
+
+  std::string discriminator_;
+  int nreplicas_;
+  bool output_2d_;
+
+  ZprimeEventView view_;
+  ZprimeEventVars vars_;
+
+  std::vector<std::unique_ptr<ReplicaHist>> hists_; // same indexing as zprime_hists (null if not booked)
+  std::unique_ptr<ReplicaHist> hyp_M_ttbar_;
+  std::unique_ptr<ReplicaHist> hyp_discriminator_;
+};
@@ -11,6 +11,9 @@
 #include <UHH2/common/include/TopJetIds.h>
 #include <UHH2/common/include/TTbarGen.h>
 
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeEventView.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeSemiLeptonicUtils.h>
+
 #include <string>
 #include <vector>
 
@@ -19,10 +22,14 @@ namespace uhh2 {
   class HTlepCut : public Selection {
    public:
     explicit HTlepCut(float, float max_htlep=infinity);
+    explicit HTlepCut(Context&, float, float max_htlep=infinity, const std::string& lepsum="LeptonSummary");
     virtual bool passes(const Event&) override;
 
    private:
     float min_htlep_, max_htlep_;
+
+    bool use_lepsum_;
+    Event::Handle<LeptonSummary> h_lepsum_;
   };
   /////
 
@@ -39,51 +46,74 @@ namespace uhh2 {
   class NJetCut : public Selection {
    public:
     explicit NJetCut(int, int nmax=999, float ptmin=0., float etamax=infinity);
+    explicit NJetCut(Context&, int, int nmax=999, float ptmin=0., float etamax=infinity, const std::string& view="ZprimeEventView");
     virtual bool passes(const Event&) override;
 
    private:
     int nmin, nmax;
     float ptmin, etamax;
+
+    bool use_view_;
+    Event::Handle<ZprimeEventView> h_view_;
   };
   /////
 
   class TwoDCut : public Selection {
    public:
-    explicit TwoDCut(float min_deltaR, float min_pTrel): min_deltaR_(min_deltaR), min_pTrel_(min_pTrel) {}
+    explicit TwoDCut(float min_deltaR, float min_pTrel): min_deltaR_(min_deltaR), min_pTrel_(min_pTrel), use_view_(false) {}
+    explicit TwoDCut(Context&, float, float, const std::string& view="ZprimeEventView", const std::string& lepsum="LeptonSummary");
     virtual bool passes(const Event&) override;
 
    private:
     float min_deltaR_, min_pTrel_;
+
+    bool use_view_;
+    Event::Handle<ZprimeEventView> h_view_;
+    Event::Handle<LeptonSummary> h_lepsum_;
   };
   /////
 
   class TwoDCut1 : public Selection {
    public:
-    explicit TwoDCut1(float min_deltaR, float min_pTrel): min_deltaR_(min_deltaR), min_pTrel_(min_pTrel) {}
+    explicit TwoDCut1(float min_deltaR, float min_pTrel): min_deltaR_(min_deltaR), min_pTrel_(min_pTrel), use_view_(false) {}
+    explicit TwoDCut1(Context&, float, float, const std::string& view="ZprimeEventView", const std::string& lepsum="LeptonSummary");
     virtual bool passes(const Event&) override;
 
    private:
     float min_deltaR_, min_pTrel_;
+
+    bool use_view_;
+    Event::Handle<ZprimeEventView> h_view_;
+    Event::Handle<LeptonSummary> h_lepsum_;
   };
   /////
 
   class TwoDCutALL : public Selection {
    public:
-    explicit TwoDCutALL(float min_deltaR, float min_pTrel): min_deltaR_(min_deltaR), min_pTrel_(min_pTrel) {}
+    explicit TwoDCutALL(float min_deltaR, float min_pTrel): min_deltaR_(min_deltaR), min_pTrel_(min_pTrel), use_view_(false) {}
+    explicit TwoDCutALL(Context&, float, float, const std::string& view="ZprimeEventView");
     virtual bool passes(const Event&) override;
 
    private:
     float min_deltaR_, min_pTrel_;
+
+    bool use_view_;
+    Event::Handle<ZprimeEventView> h_view_;
   };
   /////
 
   class TriangularCuts : public Selection {
    public:
     explicit TriangularCuts(float, float);
+    explicit TriangularCuts(Context&, float, float, const std::string& view="ZprimeEventView", const std::string& lepsum="LeptonSummary");
     virtual bool passes(const Event&) override;
 
    private:
     float a_, b_;
+
+    bool use_view_;
+    Event::Handle<ZprimeEventView> h_view_;
+    Event::Handle<LeptonSummary> h_lepsum_;
   };
   /////
 
@@ -129,6 +159,7 @@ namespace uhh2 {
    private:
     float tlep_pt_min_, tlep_pt_max_;
     Event::Handle<std::vector<ReconstructionHypothesis>> h_hyps_;
+    Event::Handle<BestHypothesis> h_best_;
     std::string disc_name_;
   };
   /////
@@ -136,13 +167,32 @@ namespace uhh2 {
   class HypothesisDiscriminatorCut: public Selection {
    public:
     explicit HypothesisDiscriminatorCut(Context&, float, float, const std::string& hyps="TTbarReconstruction", const std::string& disc_bhyp="Chi2", const std::string& disc_cut="Chi2");
+
+    /* discriminator registered in slots: value read from the BestHypothesis product of the event (BestHypothesisProducer with the same slots, no string lookups) */
+    explicit HypothesisDiscriminatorCut(Context&, float, float, const std::string& hyps, DiscriminatorSlots&, const std::string& disc_bhyp="Chi2", const std::string& disc_cut="Chi2");
+
     virtual bool passes(const Event&) override;
 
    private:
     float disc_min_, disc_max_;
     Event::Handle<std::vector<ReconstructionHypothesis>> h_hyps_;
+    Event::Handle<BestHypothesis> h_best_;
     std::string disc_bhyp_;
     std::string disc_cut_;
+
+    int slot_cut_; // -1: string-keyed lookup
+  };
+  /////
+
+  class TriggerBitSelection: public Selection {
+   public:
+    explicit TriggerBitSelection(Context&, const uint64_t, const bool require_all=false, const std::string& label="TriggerBits");
+    virtual bool passes(const Event&) override;
+
+   private:
+    uint64_t mask_;
+    bool require_all_;
+    Event::Handle<uint64_t> h_bits_;
   };
   /////
 
@@ -1,27 +1,340 @@
 #pragma once
 
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <UHH2/core/include/AnalysisModule.h>
 #include <UHH2/core/include/Event.h>
 
-class JetLeptonDeltaRCleaner : public uhh2::AnalysisModule {
+#include <UHH2/common/include/ReconstructionHypothesis.h>
+
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeEventView.h>
+
+/** \brief removes from a uhh2 particle collection the entries within DeltaR < mindr of any muon or electron
+ *
+ *  -- T: particle type of the collection, selected via its Event member (e.g. DeltaRCleaner<TopJet>(&uhh2::Event::topjets))
+ *  -- in-place stable compaction (moves, no temporary copy of the collection): input ordering (e.g. pt-ordering) is preserved
+ *  -- lepton kinematics taken from the ZprimeEventView product with the Context-based constructor
+ *  -- overlaps(): flags only, for a selection on the cleaned collection without erasing entries
+ */
+template<typename T>
+class DeltaRCleaner : public uhh2::AnalysisModule {
  public:
-  explicit JetLeptonDeltaRCleaner(float mindr=0.8): minDR_(mindr) {}
+  explicit DeltaRCleaner(std::vector<T>* uhh2::Event::* coll, float mindr=0.8): coll_(coll), minDR_(mindr), use_view_(false) {}
+  explicit DeltaRCleaner(uhh2::Context& ctx, std::vector<T>* uhh2::Event::* coll, float mindr=0.8, const std::string& view="ZprimeEventView"):
+    coll_(coll), minDR_(mindr), use_view_(true), h_view_(ctx.get_handle<ZprimeEventView>(view)) {}
+
   virtual bool process(uhh2::Event&) override;
 
+  /* overlap flag of each entry of the collection (entries removed by process), collection not modified */
+  const std::vector<char>& overlaps(const uhh2::Event&);
+
  private:
+  std::vector<T>* uhh2::Event::* coll_;
   float minDR_;
+
+  bool use_view_;
+  uhh2::Event::Handle<ZprimeEventView> h_view_;
+
+  ParticleArrays objs_, leps_;
+  std::vector<float> dr2_;
+  std::vector<char> overlap_;
 };
 
-class TopJetLeptonDeltaRCleaner : public uhh2::AnalysisModule {
+class JetLeptonDeltaRCleaner : public DeltaRCleaner<Jet> {
  public:
-  explicit TopJetLeptonDeltaRCleaner(float mindr=0.8): minDR_(mindr) {}
-  virtual bool process(uhh2::Event&) override;
+  explicit JetLeptonDeltaRCleaner(float mindr=0.8): DeltaRCleaner<Jet>(&uhh2::Event::jets, mindr) {}
+  explicit JetLeptonDeltaRCleaner(uhh2::Context& ctx, float mindr=0.8, const std::string& view="ZprimeEventView"):
+    DeltaRCleaner<Jet>(ctx, &uhh2::Event::jets, mindr, view) {}
+};
+
+class TopJetLeptonDeltaRCleaner : public DeltaRCleaner<TopJet> {
+ public:
+  explicit TopJetLeptonDeltaRCleaner(float mindr=0.8): DeltaRCleaner<TopJet>(&uhh2::Event::topjets, mindr) {}
+  explicit TopJetLeptonDeltaRCleaner(uhh2::Context& ctx, float mindr=0.8, const std::string& view="ZprimeEventView"):
+    DeltaRCleaner<TopJet>(ctx, &uhh2::Event::topjets, mindr, view) {}
+};
+
+/** \brief scoped replacement of a uhh2 event collection by a module-owned scratch copy
+ *
+ *  -- on construction the collection is copied into 'scratch' (storage reused across events) and the Event member points to it:
+ *     modules run within the scope (corrections, cleaners, selections) act on the scratch copy
+ *  -- on scope exit the Event member points again to the original collection, not modified within the scope
+ *     (the caller may still modify it afterwards, e.g. the pt-sorting of the output collections in ZprimePreSelectionModule)
+ *  -- full element copies: for flat types (Jet); collections with nested content (TopJet subjets) are better handled by ScopedJetStates
+ */
+template<typename T>
+class ScopedCollectionSwap {
+ public:
+  explicit ScopedCollectionSwap(uhh2::Event& event, std::vector<T>* uhh2::Event::* coll, std::vector<T>& scratch):
+    event_(event), coll_(coll), original_(event.*coll) {
+
+    assert(original_);
+
+    scratch.assign(original_->begin(), original_->end());
+    event_.*coll_ = &scratch;
+  }
+
+  ~ScopedCollectionSwap(){ event_.*coll_ = original_; }
+
+  ScopedCollectionSwap(const ScopedCollectionSwap&) = delete;
+  ScopedCollectionSwap& operator=(const ScopedCollectionSwap&) = delete;
 
  private:
-  float minDR_;
+  uhh2::Event& event_;
+  std::vector<T>* uhh2::Event::* coll_;
+  std::vector<T>* original_;
 };
 
-const Particle* leading_lepton(const uhh2::Event&);
+/** \brief content of a jet changed by the jet-energy corrections (JetCorrector, TopJetCorrector, JER smearing) */
+struct JetState {
+
+  LorentzVector v4;
+  float JEC_factor_raw;
+};
+
+template<typename T>
+void save_jet_states(const std::vector<T>& coll, std::vector<JetState>& states){
+
+  states.clear();
+  states.reserve(coll.size());
+  for(const auto& j : coll) states.push_back({j.v4(), j.JEC_factor_raw()});
+
+  return;
+}
+
+template<typename T>
+void restore_jet_states(std::vector<T>& coll, const std::vector<JetState>& states){
+
+  assert(coll.size() == states.size());
+
+  for(size_t i=0; i<coll.size(); ++i){
+
+    coll[i].set_v4(states[i].v4);
+    coll[i].set_JEC_factor_raw(states[i].JEC_factor_raw);
+  }
+
+  return;
+}
+
+/** \brief scoped snapshot of the JetState of each entry of a jet/topjet collection
+ *
+ *  -- on construction (v4, JEC_factor_raw) of the entries saved in 'states' (storage reused across events):
+ *     jet-energy corrections run within the scope act on the collection in place, no copy of the entries (or of the topjet subjets)
+ *  -- on scope exit the saved values are written back
+ *  -- within the scope only modules changing (v4, JEC_factor_raw) are allowed: no cleaners erasing or reordering entries
+ *     (cleaning as a pass mask, e.g. DeltaRCleaner::overlaps), no JetLeptonCleaner (also changes the lepton energy fractions of the jets)
+ */
+template<typename T>
+class ScopedJetStates {
+ public:
+  explicit ScopedJetStates(std::vector<T>& coll, std::vector<JetState>& states): coll_(coll), states_(states) { save_jet_states(coll_, states_); }
+
+  ~ScopedJetStates(){ restore_jet_states(coll_, states_); }
+
+  ScopedJetStates(const ScopedJetStates&) = delete;
+  ScopedJetStates& operator=(const ScopedJetStates&) = delete;
+
+ private:
+  std::vector<T>& coll_;
+  std::vector<JetState>& states_;
+};
+
+/* DeltaR^2 of one particle (eta, phi) wrt n particles (SoA eta/phi arrays), phi difference wrapped to [0, pi] */
+void deltaR2_row(float* dr2, const float eta, const float phi, const float* etas, const float* phis, const size_t n);
+
+/* DeltaR^2 matrix (row-major: rows.size() rows of cols.size() entries) */
+void deltaR2_matrix(std::vector<float>& dr2, const ParticleArrays& rows, const ParticleArrays& cols);
+
+/* flags (overlap[j] = 1) the entries of 'coll' with DeltaR < mindr wrt any entry of 'ref' */
+void flag_deltaR_overlaps(std::vector<char>& overlap, const ParticleArrays& coll, const ParticleArrays& ref, const float mindr, std::vector<float>& dr2_buffer);
+
+const Particle* leading_lepton(const uhh2::Event&);      // throws if the event has no leptons
+const Particle* find_leading_lepton(const uhh2::Event&); // null if the event has no leptons
 
 float HTlep (const uhh2::Event&);
 float HTlep1(const uhh2::Event&);
+
+/** \brief summary of the charged-lepton content of the event, computed in a single pass over muons and electrons
+ *         (pointer to the leading lepton is valid as long as the lepton collections are not modified)
+ */
+struct LeptonSummary {
+
+  const Particle* lep1; // pt-leading lepton (null if the event has no leptons)
+  float lep1_pt, lep1_eta, lep1_phi;
+
+  int muoN, eleN;
+
+  float HTlep;  // sum of lepton pt + MET
+  float HTlep1; // leading-lepton pt + MET (0 if no leptons)
+
+  void fill(const uhh2::Event&);
+};
+
+class LeptonSummaryProducer : public uhh2::AnalysisModule {
+ public:
+  explicit LeptonSummaryProducer(uhh2::Context&, const std::string& label="LeptonSummary");
+  virtual bool process(uhh2::Event&) override;
+
+ private:
+  uhh2::Event::Handle<LeptonSummary> h_lepsum_;
+};
+
+/** \brief ratio of the event weight of a varied to a nominal weight module, stored in the event as float (event weight unchanged)
+ *
+ *  -- nominal/varied: modules multiplying event.weight by a scale factor (e.g. MCPileupReweight central/up), each run on a unit weight
+ *  -- ratio set to 1 if the nominal scale factor is zero
+ */
+class WeightRatioProducer : public uhh2::AnalysisModule {
+ public:
+  explicit WeightRatioProducer(uhh2::Context&, const std::string& label, std::unique_ptr<uhh2::AnalysisModule> nominal, std::unique_ptr<uhh2::AnalysisModule> varied);
+  virtual bool process(uhh2::Event&) override;
+
+ private:
+  uhh2::Event::Handle<float> h_ratio_;
+  std::unique_ptr<uhh2::AnalysisModule> nominal_;
+  std::unique_ptr<uhh2::AnalysisModule> varied_;
+};
+
+/** \brief registry of hypothesis discriminators in integer slots, filled at module construction
+ *         (shared by the BestHypothesisProducer and by the readers of its slot values)
+ */
+class DiscriminatorSlots {
+ public:
+  int add(const std::string&); // slot of the discriminator (registered if new)
+
+  size_t size() const { return names_.size(); }
+  const std::string& name(const int slot) const { return names_.at(slot); }
+
+ private:
+  std::vector<std::string> names_;
+};
+
+/** \brief best ttbar hypothesis of the event for a given discriminator, computed once per event
+ *         (pointer valid as long as the hypothesis vector is not modified; null if the event has no hypotheses)
+ *
+ *  -- disc: discriminators of the best hypothesis in the DiscriminatorSlots of the producer (+infinity if not set)
+ *  -- run/lumi/event: event the product was computed for (readers fall back to the search for a stale product)
+ */
+struct BestHypothesis {
+
+  const ReconstructionHypothesis* hyp = 0;
+  std::vector<float> disc;
+
+  int run = -1, lumi = -1;
+  long long event = -1;
+
+  bool current(const uhh2::Event& e) const { return event == e.event && run == e.run && lumi == e.luminosityBlock; }
+};
+
+/** \brief producer of the BestHypothesis of the hypothesis vector "hyps" for the discriminator "disc" (label: best_hypothesis_label(hyps, disc)),
+ *         for hypotheses read from the input ntuple (discriminators stored string-keyed only)
+ *
+ *  -- slots (optional): discriminators of the best hypothesis looked up once per event and stored in BestHypothesis::disc
+ *  -- hypotheses reconstructed in the job: product filled by ZprimeTTbarReconstruction from the discriminator values it computes
+ */
+class BestHypothesisProducer : public uhh2::AnalysisModule {
+ public:
+  explicit BestHypothesisProducer(uhh2::Context&, const std::string& hyps="TTbarReconstruction", const std::string& disc="Chi2",
+                                  const std::shared_ptr<const DiscriminatorSlots>& slots=std::shared_ptr<const DiscriminatorSlots>());
+  virtual bool process(uhh2::Event&) override;
+
+ private:
+  uhh2::Event::Handle<std::vector<ReconstructionHypothesis>> h_hyps_;
+  uhh2::Event::Handle<BestHypothesis> h_best_;
+  std::string disc_;
+  std::shared_ptr<const DiscriminatorSlots> slots_;
+};
+
+inline std::string best_hypothesis_label(const std::string& hyps, const std::string& disc){ return hyps+"__best__"+disc; }
+
+/* best hypothesis from the BestHypothesis product if available for the current event, otherwise searched in the hypothesis vector (no copy) */
+const ReconstructionHypothesis* get_best_hypothesis(const uhh2::Event&, const uhh2::Event::Handle<std::vector<ReconstructionHypothesis>>&,
+                                                    const uhh2::Event::Handle<BestHypothesis>&, const std::string& disc);
+
+/** \brief per-event bit mask of a list of trigger (or MET-filter) paths, stored in the event as uint64_t
+ *
+ *  -- each path is defined by a glob pattern ('*' and '?' wildcards, e.g. "HLT_Mu45_eta2p1_v*") and gets one bit (max 64 paths);
+ *     the bit is set if any of the trigger names matching the pattern fired
+ *  -- patterns are resolved into trigger indices only when the list of trigger names changes (new run/file),
+ *     the per-event evaluation is one pass of cached index lookups over all the paths
+ *  -- a pattern without matching trigger names raises an exception (as TriggerSelection)
+ */
+class TriggerBitIndex : public uhh2::AnalysisModule {
+ public:
+  explicit TriggerBitIndex(uhh2::Context&, const std::string& label="TriggerBits");
+  virtual bool process(uhh2::Event&) override;
+
+  uint64_t add(const std::string&);
+
+ private:
+  void resolve(const uhh2::Event&);
+
+  uhh2::Event::Handle<uint64_t> h_bits_;
+
+  std::vector<std::string> patterns_;
+
+  // resolved trigger indices and the bit of the corresponding pattern
+  std::vector<uhh2::Event::TriggerIndex> indices_;
+  std::vector<uint64_t> index_bits_;
+
+  bool resolved_;
+  uhh2::Event::TriggerIndex probe_; // detects changes of the trigger-names list
+  int probe_runid_;
+};
+
+/* glob matching of 'name' against 'pattern' (wildcards: '*' any sequence, '?' any character) */
+bool glob_match(const std::string& pattern, const std::string& name);
+
+template<typename T>
+const std::vector<char>& DeltaRCleaner<T>::overlaps(const uhh2::Event& event){
+
+  const std::vector<T>* coll = event.*coll_;
+  assert(coll);
+
+  objs_.fill_angles(*coll);
+  overlap_.assign(objs_.size(), 0);
+
+  if(use_view_){
+
+    // lepton kinematics from the SoA view (view must be up-to-date wrt lepton cleaning)
+    const ZprimeEventView& view = event.get(h_view_);
+
+    flag_deltaR_overlaps(overlap_, objs_, view.muons    , minDR_, dr2_);
+    flag_deltaR_overlaps(overlap_, objs_, view.electrons, minDR_, dr2_);
+  }
+  else {
+
+    if(event.muons)    { leps_.fill_angles(*event.muons);     flag_deltaR_overlaps(overlap_, objs_, leps_, minDR_, dr2_); }
+    if(event.electrons){ leps_.fill_angles(*event.electrons); flag_deltaR_overlaps(overlap_, objs_, leps_, minDR_, dr2_); }
+  }
+
+  return overlap_;
+}
+
+template<typename T>
+bool DeltaRCleaner<T>::process(uhh2::Event& event){
+
+  std::vector<T>* coll = event.*coll_;
+  assert(coll);
+
+  overlaps(event);
+
+  // stable erase-if
+  size_t n(0);
+  for(size_t i=0; i<coll->size(); ++i){
+
+    if(overlap_[i]) continue;
+
+    if(n != i) (*coll)[n] = std::move((*coll)[i]);
+    ++n;
+  }
+
+  coll->erase(coll->begin()+n, coll->end());
+
+  return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <UHH2/core/include/Event.h>
+#include <UHH2/core/include/AnalysisModule.h>
+
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeSemiLeptonicUtils.h>
+
+/** \brief systematic variation: jet energy corrections/resolution, scale of the jet/topjet four-momenta and/or multiplicative event weight
+ *
+ *  -- jec: direction ("up" or "down") of the JEC uncertainty, applied by JetCorrector/TopJetCorrector (empty: none)
+ *  -- jer: direction ("nominal", "up" or "down") of the JER smearing of the AK4 jets, applied by JetResolutionSmearer (empty: none)
+ *  -- weight: name of a float event input holding the ratio of the varied to the nominal weight (empty: none),
+ *             e.g. the "weight_ratio__*" branches of ZprimeSelectionModule (xml key "weight_ratios")
+ */
+struct ZprimeVariation {
+
+  std::string name;
+  std::string jec;
+  std::string jer;
+  double jet_scale;
+  double topjet_scale;
+  std::string weight;
+
+  bool changes_jets()    const { return jec != "" || jer != "" || jet_scale != 1.; }
+  bool changes_topjets() const { return jec != "" || topjet_scale != 1.; }
+};
+
+/** \brief single-pass evaluation of the systematic variations on the event content
+ *
+ *  -- variations from the XML key <key> (comma-separated), each defined as "name[:jec=dir][:jer=dir][:jets=X][:topjets=X][:weight=branch]",
+ *     e.g. "jec__up:jec=up,jec__dn:jec=down,jer__up:jer=up,jer__dn:jer=down,pu__up:weight=weight_ratio__pu_up"
+ *  -- jec/jer/weight: correctors built with the JEC files of the Selection (<jec_ak4>, <jec_ak8>) and weight ratios read, MC only (no-op on data);
+ *     the Selection output is not JER-smeared, so the jer variations are relative to unsmeared jets
+ *  -- in place: the collections a variation changes are corrected/scaled in place and re-sorted in pt,
+ *     apply() saves the four-momentum and raw JEC factor of each jet (no copy of the jets/subjets),
+ *     restore() writes them back and undoes the re-ordering (see ZprimeVariationScope)
+ *  -- thresholds (pt_min, eta_max) of the Selection jet/topjet cleaning re-applied to the varied collections
+ *     (jets pushed below the threshold moved out of the collection until restore(); jets below the threshold
+ *      in the nominal event are not in the Selection ntuple and can not be recovered)
+ */
+class ZprimeVariationEngine {
+
+ public:
+  explicit ZprimeVariationEngine(uhh2::Context&, const std::string& key, const std::vector<std::string>& jec_ak4, const std::vector<std::string>& jec_ak8,
+                                 const std::pair<float, float>& jet_cut   =std::make_pair(0.f, std::numeric_limits<float>::infinity()),
+                                 const std::pair<float, float>& topjet_cut=std::make_pair(0.f, std::numeric_limits<float>::infinity()));
+
+  size_t size() const { return vars_.size(); }
+  const ZprimeVariation& variation(const size_t i) const { return vars_.at(i); }
+
+  void apply(uhh2::Event&, const size_t);
+  void restore(uhh2::Event&);
+
+ protected:
+  std::vector<ZprimeVariation> vars_;
+  std::vector<uhh2::Event::Handle<float>> h_weights_; // same indexing as vars_ (used only if weight is set)
+
+  // same indexing as vars_ (null if not used by the variation)
+  std::vector<std::unique_ptr<uhh2::AnalysisModule>> jet_correctors_;
+  std::vector<std::unique_ptr<uhh2::AnalysisModule>> topjet_correctors_;
+  std::vector<std::unique_ptr<uhh2::AnalysisModule>> jer_smearers_;
+
+  // nominal event content while a variation is applied
+  bool applied_;
+  bool jets_changed_;
+  bool topjets_changed_;
+  std::vector<JetState> jet_states_;
+  std::vector<JetState> topjet_states_;
+  std::vector<size_t> jet_order_;    // nominal index of each jet after re-sorting (empty: order unchanged)
+  std::vector<size_t> topjet_order_;
+  double nominal_weight_;
+
+  // thresholds (pt_min, eta_max) and entries moved out of the varied collections
+  std::pair<float, float> jet_cut_, topjet_cut_;
+  std::vector<Jet>    jets_dropped_;
+  std::vector<TopJet> topjets_dropped_;
+};
+
+/** \brief scoped application of one variation (nominal event content restored on scope exit) */
+class ZprimeVariationScope {
+
+ public:
+  explicit ZprimeVariationScope(ZprimeVariationEngine& engine, uhh2::Event& event, const size_t i): engine_(engine), event_(event) { engine_.apply(event_, i); }
+  ~ZprimeVariationScope(){ engine_.restore(event_); }
+
+  ZprimeVariationScope(const ZprimeVariationScope&) = delete;
+  ZprimeVariationScope& operator=(const ZprimeVariationScope&) = delete;
+
+ private:
+  ZprimeVariationEngine& engine_;
+  uhh2::Event& event_;
+};
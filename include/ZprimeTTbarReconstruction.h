@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <UHH2/core/include/AnalysisModule.h>
+#include <UHH2/core/include/Event.h>
+#include <UHH2/core/include/LorentzVector.h>
+
+#include <UHH2/common/include/ReconstructionHypothesis.h>
+#include <UHH2/common/include/TTbarReconstruction.h>
+#include <UHH2/common/include/ObjectIdUtils.h>
+
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeSemiLeptonicUtils.h>
+
+/** \brief chi2 of a ttbar hypothesis from the masses of the hadronic and leptonic top (same terms as Chi2Discriminator) */
+struct TTbarChi2 {
+
+  double mass_thad = 181., sigma_thad = 15.;
+  double mass_tlep = 174., sigma_tlep = 18.;
+
+  /* invariant mass as used by the discriminators (negative for space-like four-vectors) */
+  static float inv_mass(const LorentzVector& p4){ return p4.isTimelike() ? p4.mass() : -std::sqrt(-p4.M2()); }
+
+  double operator()(const LorentzVector& tophad, const LorentzVector& toplep) const {
+
+    return std::pow((inv_mass(tophad) - mass_thad) / sigma_thad, 2) + std::pow((inv_mass(toplep) - mass_tlep) / sigma_tlep, 2);
+  }
+
+  /* lower bound of ((m-m0)/sigma)^2 for any m in [mlo, mhi] */
+  static double bound(const double mlo, const double mhi, const double m0, const double sigma){
+
+    if(mhi < m0) return std::pow((mhi - m0) / sigma, 2);
+    if(mlo > m0) return std::pow((mlo - m0) / sigma, 2);
+
+    return 0.;
+  }
+};
+
+/** \brief jet assignment of a ttbar hypothesis, ordered by chi2 and then by position in the exhaustive enumeration */
+struct TTbarAssignment {
+
+  double chi2;
+  std::pair<unsigned long long, unsigned long long> order; // (outer index, code of the assignment)
+  std::vector<int> jets;  // choice of each jet (TTbarAssignmentSearch::choice)
+  size_t outer;           // index of the outer loop (neutrino solution, topjet)
+
+  bool operator<(const TTbarAssignment& o) const { return chi2 < o.chi2 || (chi2 == o.chi2 && order < o.order); }
+};
+
+/** \brief streaming collection of the K best hypotheses (K small): each hypothesis is scored when generated
+ *         and only the running top-K assignments are kept (storage reused across events)
+ */
+class TTbarHypothesisCollector {
+
+ public:
+  explicit TTbarHypothesisCollector(const size_t k=1);
+
+  void clear(){ n_ = 0; }
+  size_t size() const { return n_; }
+  const TTbarAssignment& at(const size_t i) const { return items_.at(i); } // sorted: at(0) is the best
+
+  /* chi2 above which a hypothesis can not enter the collection (infinity if not full) */
+  double threshold() const { return n_ < items_.size() ? std::numeric_limits<double>::infinity() : items_.back().chi2; }
+
+  void add(const double chi2, const std::pair<unsigned long long, unsigned long long>& order, const std::vector<int>& jets, const size_t outer);
+
+ protected:
+  std::vector<TTbarAssignment> items_; // capacity K, first n_ entries in use
+  size_t n_;
+};
+
+/** \brief search of the chi2-minimal assignments of jets to the hadronic top, the leptonic top or neither
+ *
+ *  -- jets assigned one at a time (in the order of the collection), complete assignments streamed into a TTbarHypothesisCollector
+ *  -- branch-and-bound (prune == true): for a partial assignment, the mass of each top lies between the mass of its current
+ *     four-vector and the mass of its four-vector plus all the unassigned jets (mass of a sum of time-like/light-like
+ *     four-vectors non-decreasing with the number of terms): branches whose chi2 lower bound exceeds the collector threshold are pruned
+ *  -- pruning disabled for inputs with space-like four-vectors (bound not valid): exhaustive search
+ *  -- hypotheses ordered as in the exhaustive enumeration (outer index, base-3/base-2 code of the assignment),
+ *     ties resolved in favour of the first one: same result as the exhaustive search + get_best_hypothesis
+ */
+class TTbarAssignmentSearch {
+
+ public:
+  enum choice { had = 0, lep = 1, none = 2 };
+
+  explicit TTbarAssignmentSearch(const bool prune=true, const TTbarChi2& chi2=TTbarChi2()): chi2_(chi2), prune_cfg_(prune), nodes_(0) {}
+
+  /* had0: initial hadronic-top four-vector (hadronic side fixed if !allow_had), lep0: leptonic W */
+  void run(const std::vector<LorentzVector>& jets, const LorentzVector& had0, const bool allow_had, const LorentzVector& lep0,
+           const unsigned long long outer, TTbarHypothesisCollector& best);
+
+  unsigned long long nodes() const { return nodes_; }
+
+ protected:
+  void search(const size_t k, const LorentzVector& had_v4, const int nhad, const LorentzVector& lep_v4, const int nlep, const unsigned long long code, TTbarHypothesisCollector& best);
+
+  TTbarChi2 chi2_;
+  bool prune_cfg_;
+
+  // current input
+  const std::vector<LorentzVector>* jets_;
+  std::vector<LorentzVector> suffix_; // suffix_[k]: sum of jets [k, n)
+  bool allow_had_;
+  bool prune_;
+  unsigned long long outer_;
+  std::vector<int> digits_;
+  std::vector<unsigned long long> weights_; // code weight of each jet digit
+
+  unsigned long long nodes_;
+};
+////
+
+/** \brief ttbar reconstruction for events without top-tag: chi2-minimal hypotheses of HighMassTTbarReconstruction (+ Chi2Discriminator),
+ *         found by TTbarAssignmentSearch instead of building all the 3^N hypotheses
+ *
+ *  -- output: vector with the top_k chi2-best hypotheses, sorted (empty if none), declared as event output
+ *     (written to the ntuple, as the hypotheses of HighMassTTbarReconstruction)
+ *  -- prune: branch-and-bound search (false: streaming of all the assignments)
+ *  -- max_jets: number of leading jets considered (10, as in HighMassTTbarReconstruction)
+ */
+class BranchBoundTTbarReconstruction : public uhh2::AnalysisModule {
+
+ public:
+  explicit BranchBoundTTbarReconstruction(uhh2::Context&, const NeutrinoReconstructionMethod&, const std::string& label="HighMassReconstruction",
+                                          const unsigned int max_jets=10, const size_t top_k=1, const bool prune=true);
+  virtual bool process(uhh2::Event&) override;
+
+ protected:
+  NeutrinoReconstructionMethod neutrinofunction_;
+  unsigned int max_jets_;
+
+  uhh2::Event::Handle<std::vector<ReconstructionHypothesis>> h_hyps_;
+  uhh2::Event::Handle<FlavorParticle> h_primlep_;
+
+  TTbarAssignmentSearch search_;
+  TTbarHypothesisCollector best_;
+  std::vector<LorentzVector> jets_;
+};
+
+/** \brief ttbar reconstruction for top-tagged events: chi2-minimal hypotheses of TopTagReconstruction (+ chi2 discriminator),
+ *         found by TTbarAssignmentSearch over the jets of the leptonic side
+ *
+ *  -- hadronic top: four-vector of the top-tagged topjet (also set as tophad_topjet_ptr, read by Chi2DiscriminatorTTAG);
+ *     leptonic top: W + non-empty subset of the jets with deltaR(jet, topjet) > minDR
+ *  -- output: the top_k chi2-best hypotheses of each top-tagged topjet (empty if none): within one topjet only the leptonic term
+ *     of the chi2 changes, the choice of the topjet is left to the discriminator run on the output;
+ *     declared as event output (written to the ntuple, as the hypotheses of TopTagReconstruction)
+ *  -- max_jets: number of leading jets considered per topjet, counted after the deltaR(jet, topjet) > minDR filter
+ *     (cap on the cleaned jet list, as in TopTagReconstruction; a cap on event.jets before the filter would drop
+ *      leptonic-side jets of events with jets overlapping the topjet)
+ */
+class BranchBoundTopTagReconstruction : public uhh2::AnalysisModule {
+
+ public:
+  explicit BranchBoundTopTagReconstruction(uhh2::Context&, const NeutrinoReconstructionMethod&, const std::string& label, const TopJetId&, const float minDR,
+                                           const unsigned int max_jets=10, const size_t top_k=1, const bool prune=true);
+  virtual bool process(uhh2::Event&) override;
+
+ protected:
+  NeutrinoReconstructionMethod neutrinofunction_;
+  TopJetId topjetID_;
+  float minDR_;
+  unsigned int max_jets_;
+
+  uhh2::Event::Handle<std::vector<ReconstructionHypothesis>> h_hyps_;
+  uhh2::Event::Handle<FlavorParticle> h_primlep_;
+
+  TTbarAssignmentSearch search_;
+  TTbarHypothesisCollector best_;
+  std::vector<LorentzVector> jets_;
+  std::vector<const Jet*> jet_ptrs_;
+};
+
+/** \brief ttbar reconstruction of the Z' analysis: hypotheses and chi2 discriminator, for events without (ttag0) or with (ttag1) top-tag
+ *
+ *  -- xml key "ttbar_reco__mode": "exhaustive" (HighMassTTbarReconstruction/TopTagReconstruction, all hypotheses),
+ *     "stream" or "bnb" (BranchBound*TTbarReconstruction: the "ttbar_reco__top_k" best hypotheses of the "ttbar_reco__max_jets"
+ *     leading jets, sorted by chi2, without or with branch-and-bound pruning)
+ *  -- disc: label of the chi2 discriminator set on the hypotheses by Chi2Discriminator/Chi2DiscriminatorTTAG (their default, "Chi2")
+ *  -- BestHypothesis product best_hypothesis_label(label, disc): slots "<disc>", "<disc>_tlep", "<disc>_thad" computed with TTbarChi2
+ *     in the pass over the hypotheses that finds the argmin (ttag1: hadronic mass from the subjets of the topjet, as Chi2DiscriminatorTTAG),
+ *     no string lookups; the other registered slots are looked up on the best hypothesis only
+ */
+class ZprimeTTbarReconstruction {
+
+ public:
+  explicit ZprimeTTbarReconstruction(uhh2::Context&, const std::string& label, const std::string& disc, const TopJetId&, const float minDR_topjet_jet,
+                                     const std::shared_ptr<DiscriminatorSlots>& slots);
+
+  void process(uhh2::Event&, const bool toptag);
+
+ protected:
+  std::unique_ptr<uhh2::AnalysisModule> reco_ttag0_, reco_ttag1_;
+  std::unique_ptr<uhh2::AnalysisModule> chi2_ttag0_, chi2_ttag1_;
+
+  uhh2::Event::Handle<std::vector<ReconstructionHypothesis>> h_hyps_;
+  uhh2::Event::Handle<BestHypothesis> h_best_;
+
+  std::string disc_;
+  std::shared_ptr<DiscriminatorSlots> slots_;
+  int slot_chi2_, slot_tlep_, slot_thad_;
+
+  TTbarChi2 chi2_;
+};
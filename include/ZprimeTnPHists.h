@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <TH3F.h>
+
+#include <UHH2/core/include/Hists.h>
+#include <UHH2/core/include/Event.h>
+
+/** \brief pass/fail histograms of the Tag-N-Probe dilepton mass for direct efficiency fits, for a list of probe working points
+ *
+ *  -- TH3F of (probe pt, probe eta [supercluster eta for electrons], M_ZLL), per working point and jet-multiplicity bin:
+ *     "<wp>__njet<N>__pass" and "<wp>__njet<N>__fail" (last jet-multiplicity bin: "njet<N>plus")
+ *  -- njet_bins: lower edges of the jet-multiplicity bins (events below the first edge not filled)
+ *  -- filled by the module for each (tag, probe) pair with fill(wp, pass, ...); fill(Event) not used
+ */
+class TnPEfficiencyHists : public uhh2::Hists {
+
+ public:
+  explicit TnPEfficiencyHists(uhh2::Context&, const std::string& dirname, const std::vector<std::string>& wps,
+                              const std::vector<double>& pt_bins, const std::vector<double>& eta_bins, const std::vector<int>& njet_bins,
+                              const int nmass, const double mass_min, const double mass_max);
+
+  virtual void fill(const uhh2::Event&) override {}
+
+  void fill(const size_t wp, const bool pass, const int njets, const float pt, const float eta, const float mass, const double weight);
+
+ protected:
+  std::vector<int> njet_bins_;
+  std::vector<TH3F*> pass_, fail_; // index: wp * njet_bins_.size() + jet-multiplicity bin
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/** \brief Tag-N-Probe record of TagNProbeZLLModule, one per (tag definition, tag, probe) row
+ *         (split branch "TnP", or vector branch "TnPs" if all the pairings are stored)
+ *
+ *  -- plain-old-data with 4-byte fields only (no padding): filled with a single copy per row,
+ *     same byte layout in the ntuple branch and in the binary sidecar file read by TnPRecordFile
+ *  -- field names as the former scalar branches (leaves "TnP.<field>" of the split branch)
+ *  -- TnPRecord::version to be increased for every change of the layout
+ */
+struct TnPRecord {
+
+  static constexpr uint32_t version = 2;
+
+  // tag definition (index in the list of tag definitions) and index of the tag lepton (0: pt-leading)
+  int32_t tagdef;
+  int32_t tag_index;
+
+  // global vars
+  float   MCweight;
+  int32_t pvN;
+  float   MET__pt;
+  float   MET__phi;
+  int32_t jetN__pt030_eta2p4;
+  int32_t jetN__pt050_eta2p4;
+  int32_t jetN__pt100_eta2p4;
+  int32_t jetN__pt200_eta2p4;
+
+  // ZLL
+  float ZLL__M;
+  float ZLL__pt;
+  float ZLL__eta;
+  float ZLL__phi;
+
+  // TAG
+  float   TAG__E;
+  float   TAG__pt;
+  float   TAG__eta;
+  float   TAG__etaSC;
+  float   TAG__phi;
+  int32_t TAG__charge;
+  float   TAG__pfIso_dbeta;
+  float   TAG__minDR_pt025;
+  float   TAG__minDR_pt030_eta2p4;
+  float   TAG__minDR_pt050_eta2p4;
+  float   TAG__pTrel_pt025;
+  float   TAG__pTrel_pt030_eta2p4;
+  float   TAG__pTrel_pt050_eta2p4;
+
+  // PROBE
+  float   PRO__E;
+  float   PRO__pt;
+  float   PRO__eta;
+  float   PRO__etaSC;
+  float   PRO__phi;
+  int32_t PRO__charge;
+  float   PRO__pfIso_dbeta;
+  float   PRO__minDR_pt025;
+  float   PRO__minDR_pt030_eta2p4;
+  float   PRO__minDR_pt050_eta2p4;
+  float   PRO__pTrel_pt025;
+  float   PRO__pTrel_pt030_eta2p4;
+  float   PRO__pTrel_pt050_eta2p4;
+};
+
+static_assert(std::is_standard_layout<TnPRecord>::value && std::is_trivially_copyable<TnPRecord>::value, "TnPRecord must be plain-old-data");
+static_assert(sizeof(TnPRecord) == 40*4, "TnPRecord must not contain padding");
+
+/** \brief tag-lepton definition of the Tag-N-Probe selection, from "name[:minDR=X][:pTrel=Y][:iso=Z][:jets=WP]"
+ *
+ *  -- lepton-2Dcut: minDR > X || pTrel > Y wrt the jets of working point WP (2D-cut applied if minDR and/or pTrel given; default of the missing one: infinity)
+ *  -- isolation: iso < Z (default: no cut)
+ *  -- WP: name of a jet working point of the TnP module (default: first one)
+ */
+struct TnPTagDefinition {
+
+  std::string name;
+  bool  use_2dcut;
+  float minDR, pTrel, iso;
+  int   jet_wp;
+
+  bool passes(const float lep_minDR, const float lep_pTrel, const float lep_iso) const {
+
+    return (!use_2dcut || lep_minDR > minDR || lep_pTrel > pTrel) && lep_iso < iso;
+  }
+};
+
+/* comma-separated list of tag definitions (jet working points referred to by the names in 'jet_wps') */
+std::vector<TnPTagDefinition> parse_tnp_tag_definitions(const std::string& cfg, const std::vector<std::string>& jet_wps);
+
+/** \brief header of the TnPRecord sidecar file (followed by 'nrecords' TnPRecord entries) */
+struct TnPRecordFileHeader {
+
+  char     magic[8];    // "TNPREC" (zero-padded)
+  uint32_t version;     // TnPRecord::version
+  uint32_t record_size; // sizeof(TnPRecord)
+  uint64_t nrecords;
+};
+
+static_assert(sizeof(TnPRecordFileHeader) == 24, "TnPRecordFileHeader must not contain padding");
+////
+
+/* name of the sidecar file of one job process: "<prefix>.<dataset>.<host>_<pid>.tnprec"
+ * (unique per dataset and per worker process, e.g. sequential InputData blocks and PROOF-lite workers)
+ */
+std::string tnp_record_file_name(const std::string& prefix, const std::string& dataset);
+
+/** \brief buffered writer of the TnPRecord sidecar file (binary, native byte order)
+ *
+ *  -- records appended with write(); number of records written in the header by close() (called by the destructor)
+ *  -- the file is created exclusively: an existing file is never truncated (the constructor throws)
+ */
+class TnPRecordWriter {
+
+ public:
+  explicit TnPRecordWriter(const std::string& filename);
+  ~TnPRecordWriter();
+
+  void write(const TnPRecord&);
+  void close();
+
+  uint64_t size() const { return nrecords_; }
+
+ protected:
+  std::string filename_;
+  std::FILE* file_;
+  uint64_t nrecords_;
+};
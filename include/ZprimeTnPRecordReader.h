@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeTnPRecord.h>
+
+/** \brief zero-copy reader of the TnPRecord sidecar file (header-only, no UHH2/ROOT dependencies: to be included by the fitting tools)
+ *
+ *  -- file memory-mapped read-only: records accessed in place as a const TnPRecord array
+ *  -- header validated (magic, layout version, record size, file size); the file must be written on a machine with the same byte order
+ *
+ *     TnPRecordFile f("ZJets.tnprec");
+ *     for(const TnPRecord& r : f) if(r.PRO__pt > 50.) ...
+ */
+class TnPRecordFile {
+
+ public:
+  explicit TnPRecordFile(const std::string& filename): map_(0), map_size_(0), records_(0), size_(0) {
+
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0) throw std::runtime_error("TnPRecordFile::TnPRecordFile -- failed to open file: "+filename);
+
+    struct stat st;
+    if(::fstat(fd, &st) != 0){ ::close(fd); throw std::runtime_error("TnPRecordFile::TnPRecordFile -- failed to stat file: "+filename); }
+
+    map_size_ = st.st_size;
+    if(map_size_ < sizeof(TnPRecordFileHeader)){ ::close(fd); throw std::runtime_error("TnPRecordFile::TnPRecordFile -- file too short: "+filename); }
+
+    map_ = ::mmap(0, map_size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map_ == MAP_FAILED){ map_ = 0; throw std::runtime_error("TnPRecordFile::TnPRecordFile -- failed to map file: "+filename); }
+
+    TnPRecordFileHeader header;
+    std::memcpy(&header, map_, sizeof(header));
+
+    std::string error;
+    if     (std::strncmp(header.magic, "TNPREC", 8) != 0) error = "not a TnPRecord file";
+    else if(header.version != TnPRecord::version)         error = "incompatible TnPRecord version";
+    else if(header.record_size != sizeof(TnPRecord))      error = "incompatible TnPRecord size";
+    else if(map_size_ < sizeof(header) + header.nrecords * sizeof(TnPRecord)) error = "truncated file";
+
+    if(error != ""){ unmap(); throw std::runtime_error("TnPRecordFile::TnPRecordFile -- "+error+": "+filename); }
+
+    records_ = reinterpret_cast<const TnPRecord*>(static_cast<const char*>(map_) + sizeof(header));
+    size_ = header.nrecords;
+
+    ::madvise(map_, map_size_, MADV_SEQUENTIAL);
+  }
+
+  ~TnPRecordFile(){ unmap(); }
+
+  TnPRecordFile(const TnPRecordFile&) = delete;
+  TnPRecordFile& operator=(const TnPRecordFile&) = delete;
+
+  size_t size() const { return size_; }
+
+  const TnPRecord& operator[](const size_t i) const { return records_[i]; }
+  const TnPRecord* begin() const { return records_; }
+  const TnPRecord* end()   const { return records_ + size_; }
+
+ protected:
+  void unmap(){ if(map_){ ::munmap(map_, map_size_); map_ = 0; } }
+
+  void* map_;
+  size_t map_size_;
+  const TnPRecord* records_;
+  size_t size_;
+};
@@ -1,12 +1,13 @@
+#include <algorithm>
 #include <iostream>
 #include <memory>
 
 #include "UHH2/core/include/AnalysisModule.h"
 #include "UHH2/core/include/Event.h"
 #include "UHH2/core/include/Selection.h"
+#include "UHH2/core/include/Utils.h"
 
 #include "UHH2/common/include/NSelections.h"
-#include "UHH2/common/include/TriggerSelection.h"
 #include "UHH2/common/include/CleaningModules.h"
 #include "UHH2/common/include/ObjectIdUtils.h"
 #include "UHH2/common/include/MuonIds.h"
@@ -16,7 +17,12 @@
 #include "UHH2/common/include/Utils.h"
 #include "UHH2/common/include/EventHists.h"
 
+#include "UHH2/ZprimeSemiLeptonic/include/ZprimeSemiLeptonicSelections.h"
 #include "UHH2/ZprimeSemiLeptonic/include/ZprimeSemiLeptonicUtils.h"
+#include "UHH2/ZprimeSemiLeptonic/include/ZprimeCutflow.h"
+#include "UHH2/ZprimeSemiLeptonic/include/ZprimeProductScheduler.h"
+#include "UHH2/ZprimeSemiLeptonic/include/ZprimeTnPRecord.h"
+#include "UHH2/ZprimeSemiLeptonic/include/ZprimeTnPHists.h"
 
 /** \brief module to produce "Tag-N-Probe" ntuples for Z->ll control region
  *         used in Z'->ttbar semileptonic analysis to measure lepton efficiencies (e.g. lepton 2D-cut)
@@ -33,6 +39,18 @@
  *           -- NB: avoid triangular cuts b/c correlated to MET cut (and Z->ll sample has no real MET)
  *     * PROBE lepton : same lepton selection (pt+eta+ID) as for lepton in l+jets SR
  *
+ *  -- TAG definitions: xml key "tnp__tag_definitions" (see TnPTagDefinition, default: "default:minDR=0.4:iso=0.1")
+ *   * "tnp__pairing" = "first" (default): first lepton (pt-ordering) passing the first tag definition is the TAG, the other one the PROBE
+ *   * "tnp__pairing" = "all": every tag definition evaluated on both leptons, one row per valid (definition, tag, probe) combination
+ *
+ *  -- OUTPUT:
+ *   * TnP vars stored in one TnPRecord per row (split branch "TnP" for "first" pairing, vector branch "TnPs" for "all" pairings)
+ *   * optional binary copy of the records (xml key "tnp__record_file": path prefix), read in place by TnPRecordFile (ZprimeTnPRecordReader.h):
+ *     one file per dataset and worker process, "<prefix>.<dataset_version>.<host>_<pid>.tnprec" (see tnp_record_file_name)
+ *   * optional pass/fail histograms of M_ZLL (xml key "tnp__hists" = "true", see TnPEfficiencyHists) in directories "tnp__<tag definition>":
+ *     probe working points "tnp__hists__probe_wps" (same syntax as the tag definitions), probe pt/eta bin edges "tnp__hists__pt_bins"/"__eta_bins",
+ *     jet multiplicity of working point "tnp__hists__njet" binned with the lower edges "tnp__hists__njet_bins", M_ZLL binning "tnp__hists__mass" (N:min:max)
+ *
  */
 using namespace uhh2;
 
@@ -51,64 +69,41 @@ class TagNProbeZLLModule: public AnalysisModule {
   std::unique_ptr<JetCorrector> jet_corrector;
   std::unique_ptr<JetResolutionSmearer> jetER_smearer;
   std::unique_ptr<JetLeptonCleaner> jetlepton_cleaner;
-  std::unique_ptr<JetCleaner> jet_cleaner1;
-  std::unique_ptr<JetCleaner> jet_cleaner2;
-  std::unique_ptr<JetCleaner> jet_cleaner3;
-  std::unique_ptr<JetCleaner> jet_cleaner4;
-  std::unique_ptr<JetCleaner> jet_cleaner5;
+
+  // jet working points of the TnP vars, evaluated in one sweep over the jets (jet collection not modified)
+  enum jet_wp { pt025, pt030_eta2p4, pt050_eta2p4, pt100_eta2p4, pt200_eta2p4 };
+  std::unique_ptr<JetWorkingPointSweep> jet_sweep;
+  ParticleArrays jet_arrays, lep_arrays;
+
+  // HLT path resolved once per trigger menu
+  std::unique_ptr<TriggerBitIndex> trigger_bits;
+
+  // lazy object reconstruction
+  ProductScheduler products;
 
   // selections
-  std::unique_ptr<Selection> trigger_sel;
-  std::unique_ptr<AndSelection> lep2_sel;
-  std::unique_ptr<Selection> jet2_sel;
-  std::unique_ptr<Selection> jet1_sel;
+  std::unique_ptr<Cutflow> lep_cutflow; // HLT, ==2 leptons
+  std::unique_ptr<Cutflow> jet_cutflow; // >=2 jets, >=1 jet
 
   // hists
   std::unique_ptr<Hists> hi_input__event;
   std::unique_ptr<Hists> hi_output__event;
 
+  // tag definitions
+  std::vector<TnPTagDefinition> tag_defs;
+  bool all_pairings;
+
   // TnP vars
-  Event::Handle<float> h_MCweight;
-  Event::Handle<int>   h_pvN;
-  Event::Handle<float> h_MET__pt;
-  Event::Handle<float> h_MET__phi;
-  Event::Handle<int>   h_jetN__pt030_eta2p4;
-  Event::Handle<int>   h_jetN__pt050_eta2p4;
-  Event::Handle<int>   h_jetN__pt100_eta2p4;
-  Event::Handle<int>   h_jetN__pt200_eta2p4;
-
-  Event::Handle<float> h_ZLL__M;
-  Event::Handle<float> h_ZLL__pt;
-  Event::Handle<float> h_ZLL__eta;
-  Event::Handle<float> h_ZLL__phi;
-
-  Event::Handle<float> h_TAG__E;
-  Event::Handle<float> h_TAG__pt;
-  Event::Handle<float> h_TAG__eta;
-  Event::Handle<float> h_TAG__etaSC;
-  Event::Handle<float> h_TAG__phi;
-  Event::Handle<int>   h_TAG__charge;
-  Event::Handle<float> h_TAG__pfIso_dbeta;
-  Event::Handle<float> h_TAG__minDR_pt025;
-  Event::Handle<float> h_TAG__minDR_pt030_eta2p4;
-  Event::Handle<float> h_TAG__minDR_pt050_eta2p4;
-  Event::Handle<float> h_TAG__pTrel_pt025;
-  Event::Handle<float> h_TAG__pTrel_pt030_eta2p4;
-  Event::Handle<float> h_TAG__pTrel_pt050_eta2p4;
-
-  Event::Handle<float> h_PRO__E;
-  Event::Handle<float> h_PRO__pt;
-  Event::Handle<float> h_PRO__eta;
-  Event::Handle<float> h_PRO__etaSC;
-  Event::Handle<float> h_PRO__phi;
-  Event::Handle<int>   h_PRO__charge;
-  Event::Handle<float> h_PRO__pfIso_dbeta;
-  Event::Handle<float> h_PRO__minDR_pt025;
-  Event::Handle<float> h_PRO__minDR_pt030_eta2p4;
-  Event::Handle<float> h_PRO__minDR_pt050_eta2p4;
-  Event::Handle<float> h_PRO__pTrel_pt025;
-  Event::Handle<float> h_PRO__pTrel_pt030_eta2p4;
-  Event::Handle<float> h_PRO__pTrel_pt050_eta2p4;
+  Event::Handle<TnPRecord> h_tnp;
+  Event::Handle<std::vector<TnPRecord>> h_tnps;
+  std::vector<TnPRecord> tnps;
+
+  std::unique_ptr<TnPRecordWriter> tnp_file;
+
+  // pass/fail hists of the probe working points (one set per tag definition)
+  std::vector<TnPTagDefinition> probe_wps;
+  int njet_wp;
+  std::vector<std::unique_ptr<TnPEfficiencyHists>> hi_tnp;
 };
 
 TagNProbeZLLModule::TagNProbeZLLModule(Context & ctx){
@@ -120,16 +115,17 @@ TagNProbeZLLModule::TagNProbeZLLModule(Context & ctx){
   jetER_smearer.reset(new JetResolutionSmearer(ctx));
   jetlepton_cleaner.reset(new JetLeptonCleaner(ctx, JERFiles::PHYS14_L123_MC));
   jetlepton_cleaner->set_drmax(.4);
-  jet_cleaner1.reset(new JetCleaner( 25., std::numeric_limits<double>::infinity()));
-  jet_cleaner2.reset(new JetCleaner( 30., 2.4));
-  jet_cleaner3.reset(new JetCleaner( 50., 2.4));
-  jet_cleaner4.reset(new JetCleaner(100., 2.4));
-  jet_cleaner5.reset(new JetCleaner(200., 2.4));
+  jet_sweep.reset(new JetWorkingPointSweep({{25., std::numeric_limits<float>::infinity()}, {30., 2.4}, {50., 2.4}, {100., 2.4}, {200., 2.4}}));
   ////
 
   //// EVENT SELECTION
   const std::string trigger(ctx.get("trigger", "NULL"));
-  if(trigger != "NULL") trigger_sel.reset(new TriggerSelection(trigger));
+  std::unique_ptr<Selection> trigger_sel;
+  if(trigger != "NULL"){
+
+    trigger_bits.reset(new TriggerBitIndex(ctx));
+    trigger_sel.reset(new TriggerBitSelection(ctx, trigger_bits->add(trigger)));
+  }
   else trigger_sel.reset(new AndSelection(ctx));
 
   const std::string channel_str(ctx.get("channel", ""));
@@ -137,7 +133,7 @@ TagNProbeZLLModule::TagNProbeZLLModule(Context & ctx){
   else if(channel_str == "elec") channel = elec;
   else throw std::runtime_error("undefined argument for 'channel' key in xml file (must be 'muon' or 'elec'): "+channel_str);
 
-  lep2_sel.reset(new AndSelection(ctx));
+  std::unique_ptr<AndSelection> lep2_sel(new AndSelection(ctx));
   if(channel == muon){
     lep2_sel->add<NMuonSelection>    ("muoN == 2", 2, 2);
     lep2_sel->add<NElectronSelection>("eleN == 0", 0, 0);
@@ -147,8 +143,31 @@ TagNProbeZLLModule::TagNProbeZLLModule(Context & ctx){
     lep2_sel->add<NElectronSelection>("eleN == 2", 2, 2);
   }
 
-  jet2_sel.reset(new NJetSelection(2, -1, JetId(PtEtaCut( 50., 2.4))));
-  jet1_sel.reset(new NJetSelection(1, -1, JetId(PtEtaCut(200., 2.4))));
+  products.add("leptons", [this](Event& event){
+
+    muo_cleaner->process(event);
+    sort_by_pt<Muon>(*event.muons);
+
+    ele_cleaner->process(event);
+    sort_by_pt<Electron>(*event.electrons);
+  });
+
+  products.add("jets", [this](Event& event){
+
+    jet_corrector->process(event);
+    jetER_smearer->process(event);
+    jetlepton_cleaner->process(event);
+  }, {"leptons"});
+
+  lep_cutflow.reset(new Cutflow("cutflow__lep", &products));
+  lep_cutflow->add("trigger", std::move(trigger_sel));
+  lep_cutflow->add("lep2"   , std::move(lep2_sel), nullptr, {"leptons"});
+  lep_cutflow->finalize(ctx);
+
+  jet_cutflow.reset(new Cutflow("cutflow__jet", &products));
+  jet_cutflow->add("jet2", make_unique<NJetSelection>(2, -1, JetId(PtEtaCut( 50., 2.4))), nullptr, {"jets"});
+  jet_cutflow->add("jet1", make_unique<NJetSelection>(1, -1, JetId(PtEtaCut(200., 2.4))), nullptr, {"jets"});
+  jet_cutflow->finalize(ctx);
   ////
 
   //// HISTS
@@ -156,49 +175,56 @@ TagNProbeZLLModule::TagNProbeZLLModule(Context & ctx){
   hi_output__event.reset(new EventHists(ctx, "output__event"));
   ////
 
+  //// TAG DEFINITIONS
+  tag_defs = parse_tnp_tag_definitions(ctx.get("tnp__tag_definitions", "default:minDR=0.4:iso=0.1"), {"pt025", "pt030_eta2p4", "pt050_eta2p4", "pt100_eta2p4", "pt200_eta2p4"});
+
+  const std::string pairing(ctx.get("tnp__pairing", "first"));
+  if     (pairing == "first") all_pairings = false;
+  else if(pairing == "all"  ) all_pairings = true;
+  else throw std::runtime_error("undefined argument for 'tnp__pairing' key in xml file (must be 'first' or 'all'): "+pairing);
+  ////
+
   //// TNP VARS
-  h_MCweight           = ctx.declare_event_output<float> ("MCweight");
-
-  h_pvN                = ctx.declare_event_output<int>   ("pvN");
-  h_MET__pt            = ctx.declare_event_output<float> ("MET__pt");
-  h_MET__phi           = ctx.declare_event_output<float> ("MET__phi");
-  h_jetN__pt030_eta2p4 = ctx.declare_event_output<int>   ("jetN__pt030_eta2p4");
-  h_jetN__pt050_eta2p4 = ctx.declare_event_output<int>   ("jetN__pt050_eta2p4");
-  h_jetN__pt100_eta2p4 = ctx.declare_event_output<int>   ("jetN__pt100_eta2p4");
-  h_jetN__pt200_eta2p4 = ctx.declare_event_output<int>   ("jetN__pt200_eta2p4");
-  				
-  h_ZLL__M   = ctx.declare_event_output<float> ("ZLL__M");
-  h_ZLL__pt  = ctx.declare_event_output<float> ("ZLL__pt");
-  h_ZLL__eta = ctx.declare_event_output<float> ("ZLL__eta");
-  h_ZLL__phi = ctx.declare_event_output<float> ("ZLL__phi");
-  				
-  h_TAG__E                 = ctx.declare_event_output<float> ("TAG__E");
-  h_TAG__pt                = ctx.declare_event_output<float> ("TAG__pt");
-  h_TAG__eta               = ctx.declare_event_output<float> ("TAG__eta");
-  h_TAG__etaSC             = ctx.declare_event_output<float> ("TAG__etaSC");
-  h_TAG__phi               = ctx.declare_event_output<float> ("TAG__phi");
-  h_TAG__charge            = ctx.declare_event_output<int>   ("TAG__charge");
-  h_TAG__pfIso_dbeta       = ctx.declare_event_output<float> ("TAG__pfIso_dbeta");
-  h_TAG__minDR_pt025        = ctx.declare_event_output<float> ("TAG__minDR_pt025");
-  h_TAG__minDR_pt030_eta2p4 = ctx.declare_event_output<float> ("TAG__minDR_pt030_eta2p4");
-  h_TAG__minDR_pt050_eta2p4 = ctx.declare_event_output<float> ("TAG__minDR_pt050_eta2p4");
-  h_TAG__pTrel_pt025        = ctx.declare_event_output<float> ("TAG__pTrel_pt025");
-  h_TAG__pTrel_pt030_eta2p4 = ctx.declare_event_output<float> ("TAG__pTrel_pt030_eta2p4");
-  h_TAG__pTrel_pt050_eta2p4 = ctx.declare_event_output<float> ("TAG__pTrel_pt050_eta2p4");
-  				
-  h_PRO__E                 = ctx.declare_event_output<float> ("PRO__E");
-  h_PRO__pt                = ctx.declare_event_output<float> ("PRO__pt");
-  h_PRO__eta               = ctx.declare_event_output<float> ("PRO__eta");
-  h_PRO__etaSC             = ctx.declare_event_output<float> ("PRO__etaSC");
-  h_PRO__phi               = ctx.declare_event_output<float> ("PRO__phi");
-  h_PRO__charge            = ctx.declare_event_output<int>   ("PRO__charge");
-  h_PRO__pfIso_dbeta       = ctx.declare_event_output<float> ("PRO__pfIso_dbeta");
-  h_PRO__minDR_pt025        = ctx.declare_event_output<float> ("PRO__minDR_pt025");
-  h_PRO__minDR_pt030_eta2p4 = ctx.declare_event_output<float> ("PRO__minDR_pt030_eta2p4");
-  h_PRO__minDR_pt050_eta2p4 = ctx.declare_event_output<float> ("PRO__minDR_pt050_eta2p4");
-  h_PRO__pTrel_pt025        = ctx.declare_event_output<float> ("PRO__pTrel_pt025");
-  h_PRO__pTrel_pt030_eta2p4 = ctx.declare_event_output<float> ("PRO__pTrel_pt030_eta2p4");
-  h_PRO__pTrel_pt050_eta2p4 = ctx.declare_event_output<float> ("PRO__pTrel_pt050_eta2p4");
+  if(all_pairings) h_tnps = ctx.declare_event_output<std::vector<TnPRecord>>("TnPs");
+  else             h_tnp  = ctx.declare_event_output<TnPRecord>("TnP");
+
+  const std::string tnp_file_prefix(ctx.get("tnp__record_file", ""));
+  if(tnp_file_prefix != "") tnp_file.reset(new TnPRecordWriter(tnp_record_file_name(tnp_file_prefix, ctx.get("dataset_version"))));
+  ////
+
+  //// TNP HISTS
+  const std::string tnp_hists(ctx.get("tnp__hists", "false"));
+  if(tnp_hists == "true"){
+
+    const std::vector<std::string> jet_wps = {"pt025", "pt030_eta2p4", "pt050_eta2p4", "pt100_eta2p4", "pt200_eta2p4"};
+
+    probe_wps = parse_tnp_tag_definitions(ctx.get("tnp__hists__probe_wps", "2Dcut:minDR=0.4:pTrel=25"), jet_wps);
+
+    std::vector<std::string> probe_wp_names;
+    for(const auto& wp : probe_wps) probe_wp_names.push_back(wp.name);
+
+    std::vector<double> pt_bins, eta_bins;
+    std::vector<int> njet_bins;
+    for(const auto& x : split(ctx.get("tnp__hists__pt_bins"  , "50,60,80,100,150,200,300,500,1000")                    , ",")) pt_bins  .push_back(std::stod(x));
+    for(const auto& x : split(ctx.get("tnp__hists__eta_bins" , "-2.5,-1.566,-1.4442,-0.8,0,0.8,1.4442,1.566,2.5"), ",")) eta_bins .push_back(std::stod(x));
+    for(const auto& x : split(ctx.get("tnp__hists__njet_bins", "2,3,4")                                                , ",")) njet_bins.push_back(std::stoi(x));
+
+    const std::string njet(ctx.get("tnp__hists__njet", "pt030_eta2p4"));
+    const auto it = std::find(jet_wps.begin(), jet_wps.end(), njet);
+    if(it == jet_wps.end()) throw std::runtime_error("undefined argument for 'tnp__hists__njet' key in xml file (must be a jet working point name): "+njet);
+    njet_wp = it - jet_wps.begin();
+
+    const std::string mass(ctx.get("tnp__hists__mass", "60:60:120"));
+    const auto mass_fields = split(mass, ":");
+    if(mass_fields.size() != 3) throw std::runtime_error("invalid argument for 'tnp__hists__mass' key in xml file (must be 'N:min:max'): "+mass);
+
+    for(size_t d=0; d<(all_pairings ? tag_defs.size() : 1); ++d){
+
+      hi_tnp.emplace_back(new TnPEfficiencyHists(ctx, "tnp__"+tag_defs[d].name, probe_wp_names, pt_bins, eta_bins, njet_bins,
+                                                 std::stoi(mass_fields.at(0)), std::stod(mass_fields.at(1)), std::stod(mass_fields.at(2))));
+    }
+  }
+  else if(tnp_hists != "false") throw std::runtime_error("undefined argument for 'tnp__hists' key in xml file (must be 'true' or 'false'): "+tnp_hists);
   ////
 
   // remove default input collections from output
@@ -225,175 +251,152 @@ bool TagNProbeZLLModule::process(Event & event){
 
   hi_input__event->fill(event);
 
-  //// HLT selection
-  bool pass_trigger = trigger_sel->passes(event);
-  if(!pass_trigger) return false;
-  ////
-
-  //// LEPTON selection
-  muo_cleaner->process(event);
-  sort_by_pt<Muon>(*event.muons);
+  if(trigger_bits) trigger_bits->process(event);
 
-  ele_cleaner->process(event);
-  sort_by_pt<Electron>(*event.electrons);
+  products.reset();
 
-  bool pass_lep2 = lep2_sel->passes(event);
-  if(!pass_lep2) return false;
+  //// HLT + LEPTON selection [lepton cleaning run after HLT]
+  if(!lep_cutflow->process(event)) return false;
   ////
 
-  //// JET selection
-  jet_corrector->process(event);
-  jetER_smearer->process(event);
-  jetlepton_cleaner->process(event);
-
-  /* 2nd AK4 jet selection */
-  bool pass_jet2 = jet2_sel->passes(event);
-  if(!pass_jet2) return false;
-
-  /* 1st AK4 jet selection */
-  bool pass_jet1 = jet1_sel->passes(event);
-  if(!pass_jet1) return false;
+  //// JET selection [JEC run after lepton selection]
+  if(!jet_cutflow->process(event)) return false;
   ////
 
   hi_output__event->fill(event);
 
-  /* TAG and PROBE assignment */
-  const Particle *tag(0), *pro(0);
+  /* jet multiplicities and lepton-jet (minDR, pTrel) of all the jet working points */
+  jet_arrays.fill(*event.jets);
+  if     (channel == muon) lep_arrays.fill(*event.muons);
+  else if(channel == elec) lep_arrays.fill(*event.electrons);
+
+  jet_sweep->run(jet_arrays, lep_arrays);
 
-  jet_cleaner1->process(event);
-  sort_by_pt<Jet>(*event.jets);
+  /* lepton vars */
+  float etaSC[2] = {0., 0.}, pfIso_dbeta[2] = {0., 0.};
+  const Particle* leps[2] = {0, 0};
 
   if(channel == muon){
 
     if(event.muons->size() != 2) 
       throw std::runtime_error("logical error: incorrect number of muons (!=2)");
 
-    for(const auto& muo : *event.muons){
-
-      float minDR_pt025(0.), pTrel_pt025(0.);
-      std::tie(minDR_pt025, pTrel_pt025) = drmin_pTrel(muo, *event.jets);
-
-      if(minDR_pt025 > .4 && muo.relIso() < .1){ tag = &muo; break; }
+    for(size_t i=0; i<2; ++i){
+      leps[i]        = &event.muons->at(i);
+      pfIso_dbeta[i] = event.muons->at(i).relIso();
     }
-
-    if(!tag) return false;
-
-    pro = (tag == &event.muons->at(0)) ? &event.muons->at(1) : &event.muons->at(0);
   }
   else if(channel == elec){
 
     if(event.electrons->size() != 2) 
       throw std::runtime_error("logical error: incorrect number of electrons (!=2)");
 
-    for(const auto& ele : *event.electrons){
-
-      float minDR_pt025(0.), pTrel_pt025(0.);
-      std::tie(minDR_pt025, pTrel_pt025) = drmin_pTrel(ele, *event.jets);
-
-      if(minDR_pt025 > .4 && ele.relIsodb() < .1){ tag = &ele; break; }
+    for(size_t i=0; i<2; ++i){
+      leps[i]        = &event.electrons->at(i);
+      pfIso_dbeta[i] = event.electrons->at(i).relIsodb();
+      etaSC[i]       = event.electrons->at(i).supercluster_eta();
     }
-
-    if(!tag) return false;
-
-    pro = (tag == &event.electrons->at(0)) ? &event.electrons->at(1) : &event.electrons->at(0);
   }
 
-  /* add TnP vars to output ntuple */
-
-  // global vars
-  event.set(h_MCweight, event.weight);
-
-  event.set(h_pvN     , event.pvs->size());
-  event.set(h_MET__pt , event.met->pt());
-  event.set(h_MET__phi, event.met->phi());
-  //
-
-  float tag__minDR_pt025(0.), tag__minDR_pt030_eta2p4(0.), tag__minDR_pt050_eta2p4(0.);
-  float tag__pTrel_pt025(0.), tag__pTrel_pt030_eta2p4(0.), tag__pTrel_pt050_eta2p4(0.);
-
-  float pro__minDR_pt025(0.), pro__minDR_pt030_eta2p4(0.), pro__minDR_pt050_eta2p4(0.);
-  float pro__pTrel_pt025(0.), pro__pTrel_pt030_eta2p4(0.), pro__pTrel_pt050_eta2p4(0.);
-
-  std::tie(tag__minDR_pt025, tag__pTrel_pt025) = drmin_pTrel(*tag, *event.jets);
-  std::tie(pro__minDR_pt025, pro__pTrel_pt025) = drmin_pTrel(*pro, *event.jets);
-  //
-
-  jet_cleaner2->process(event);
-  sort_by_pt<Jet>(*event.jets);
-  event.set(h_jetN__pt030_eta2p4, event.jets->size());
-
-  std::tie(tag__minDR_pt030_eta2p4, tag__pTrel_pt030_eta2p4) = drmin_pTrel(*tag, *event.jets);
-  std::tie(pro__minDR_pt030_eta2p4, pro__pTrel_pt030_eta2p4) = drmin_pTrel(*pro, *event.jets);
-  //
+  /* TAG and PROBE assignment: (definition, tag index) rows */
+  std::vector<std::pair<int, int>> rows;
 
-  jet_cleaner3->process(event);
-  sort_by_pt<Jet>(*event.jets);
-  event.set(h_jetN__pt050_eta2p4, event.jets->size());
+  for(size_t d=0; d<(all_pairings ? tag_defs.size() : 1); ++d){
 
-  std::tie(tag__minDR_pt050_eta2p4, tag__pTrel_pt050_eta2p4) = drmin_pTrel(*tag, *event.jets);
-  std::tie(pro__minDR_pt050_eta2p4, pro__pTrel_pt050_eta2p4) = drmin_pTrel(*pro, *event.jets);
-  //
+    const TnPTagDefinition& def = tag_defs[d];
 
-  jet_cleaner4->process(event);
-  sort_by_pt<Jet>(*event.jets);
-  event.set(h_jetN__pt100_eta2p4, event.jets->size());
-  //
+    for(int i=0; i<2; ++i){
 
-  jet_cleaner5->process(event);
-  sort_by_pt<Jet>(*event.jets);
-  event.set(h_jetN__pt200_eta2p4, event.jets->size());
-  //
+      if(!def.passes(jet_sweep->minDR(i, def.jet_wp), jet_sweep->pTrel(i, def.jet_wp), pfIso_dbeta[i])) continue;
 
-  float tag__etaSC(0.), tag__pfIso_dbeta(0.);
-  float pro__etaSC(0.), pro__pfIso_dbeta(0.);
-
-  if(channel == muon){
-    tag__pfIso_dbeta = ((Muon*) tag)->relIso();
-    pro__pfIso_dbeta = ((Muon*) pro)->relIso();
+      rows.push_back(std::make_pair(d, i));
+      if(!all_pairings) break;
+    }
   }
-  else if(channel == elec){
-    tag__pfIso_dbeta = ((Electron*) tag)->relIsodb();
-    pro__pfIso_dbeta = ((Electron*) pro)->relIsodb();
 
-    tag__etaSC = ((Electron*) tag)->supercluster_eta();
-    pro__etaSC = ((Electron*) pro)->supercluster_eta();
+  if(rows.empty()) return false;
+
+  /* add TnP vars to output ntuple */
+  tnps.resize(rows.size());
+
+  for(size_t r=0; r<rows.size(); ++r){
+
+    const int itag(rows[r].second), ipro(1 - rows[r].second);
+    const Particle *tag(leps[itag]), *pro(leps[ipro]);
+
+    TnPRecord& tnp = tnps[r];
+
+    tnp.tagdef    = rows[r].first;
+    tnp.tag_index = itag;
+
+    // global vars
+    tnp.MCweight = event.weight;
+
+    tnp.pvN      = event.pvs->size();
+    tnp.MET__pt  = event.met->pt();
+    tnp.MET__phi = event.met->phi();
+
+    tnp.jetN__pt030_eta2p4 = jet_sweep->njets(pt030_eta2p4);
+    tnp.jetN__pt050_eta2p4 = jet_sweep->njets(pt050_eta2p4);
+    tnp.jetN__pt100_eta2p4 = jet_sweep->njets(pt100_eta2p4);
+    tnp.jetN__pt200_eta2p4 = jet_sweep->njets(pt200_eta2p4);
+    //
+
+    /* ZLL */
+    tnp.ZLL__M   = (tag->v4()+pro->v4()).M();
+    tnp.ZLL__pt  = (tag->v4()+pro->v4()).Pt();
+    tnp.ZLL__eta = (tag->v4()+pro->v4()).Eta();
+    tnp.ZLL__phi = (tag->v4()+pro->v4()).Phi();
+
+    /* TAG */
+    tnp.TAG__E                  = tag->v4().E();
+    tnp.TAG__pt                 = tag->v4().Pt();
+    tnp.TAG__eta                = tag->v4().Eta();
+    tnp.TAG__etaSC              = etaSC[itag];
+    tnp.TAG__phi                = tag->v4().Phi();
+    tnp.TAG__charge             = int(tag->charge());
+    tnp.TAG__pfIso_dbeta        = pfIso_dbeta[itag];
+    tnp.TAG__minDR_pt025        = jet_sweep->minDR(itag, pt025);
+    tnp.TAG__minDR_pt030_eta2p4 = jet_sweep->minDR(itag, pt030_eta2p4);
+    tnp.TAG__minDR_pt050_eta2p4 = jet_sweep->minDR(itag, pt050_eta2p4);
+    tnp.TAG__pTrel_pt025        = jet_sweep->pTrel(itag, pt025);
+    tnp.TAG__pTrel_pt030_eta2p4 = jet_sweep->pTrel(itag, pt030_eta2p4);
+    tnp.TAG__pTrel_pt050_eta2p4 = jet_sweep->pTrel(itag, pt050_eta2p4);
+
+    /* PROBE */
+    tnp.PRO__E                  = pro->v4().E();
+    tnp.PRO__pt                 = pro->v4().Pt();
+    tnp.PRO__eta                = pro->v4().Eta();
+    tnp.PRO__etaSC              = etaSC[ipro];
+    tnp.PRO__phi                = pro->v4().Phi();
+    tnp.PRO__charge             = int(pro->charge());
+    tnp.PRO__pfIso_dbeta        = pfIso_dbeta[ipro];
+    tnp.PRO__minDR_pt025        = jet_sweep->minDR(ipro, pt025);
+    tnp.PRO__minDR_pt030_eta2p4 = jet_sweep->minDR(ipro, pt030_eta2p4);
+    tnp.PRO__minDR_pt050_eta2p4 = jet_sweep->minDR(ipro, pt050_eta2p4);
+    tnp.PRO__pTrel_pt025        = jet_sweep->pTrel(ipro, pt025);
+    tnp.PRO__pTrel_pt030_eta2p4 = jet_sweep->pTrel(ipro, pt030_eta2p4);
+    tnp.PRO__pTrel_pt050_eta2p4 = jet_sweep->pTrel(ipro, pt050_eta2p4);
+
+    if(tnp_file) tnp_file->write(tnp);
+
+    /* pass/fail hists of the probe working points */
+    if(!hi_tnp.empty()){
+
+      const float pro__eta = (channel == elec) ? tnp.PRO__etaSC : tnp.PRO__eta;
+
+      for(size_t w=0; w<probe_wps.size(); ++w){
+
+        const TnPTagDefinition& wp = probe_wps[w];
+        const bool pass = wp.passes(jet_sweep->minDR(ipro, wp.jet_wp), jet_sweep->pTrel(ipro, wp.jet_wp), pfIso_dbeta[ipro]);
+
+        hi_tnp.at(tnp.tagdef)->fill(w, pass, jet_sweep->njets(njet_wp), tnp.PRO__pt, pro__eta, tnp.ZLL__M, event.weight);
+      }
+    }
   }
 
-  /* ZLL */
-  event.set(h_ZLL__M  , (tag->v4()+pro->v4()).M());
-  event.set(h_ZLL__pt , (tag->v4()+pro->v4()).Pt());
-  event.set(h_ZLL__eta, (tag->v4()+pro->v4()).Eta());
-  event.set(h_ZLL__phi, (tag->v4()+pro->v4()).Phi());
-
-  /* TAG */
-  event.set(h_TAG__E                 , tag->v4().E());
-  event.set(h_TAG__pt                , tag->v4().Pt());
-  event.set(h_TAG__eta               , tag->v4().Eta());
-  event.set(h_TAG__etaSC             , tag__etaSC);
-  event.set(h_TAG__phi               , tag->v4().Phi());
-  event.set(h_TAG__charge            , int(tag->charge()));
-  event.set(h_TAG__pfIso_dbeta       , tag__pfIso_dbeta);
-  event.set(h_TAG__minDR_pt025       , tag__minDR_pt025);
-  event.set(h_TAG__minDR_pt030_eta2p4, tag__minDR_pt030_eta2p4);
-  event.set(h_TAG__minDR_pt050_eta2p4, tag__minDR_pt050_eta2p4);
-  event.set(h_TAG__pTrel_pt025       , tag__pTrel_pt025);
-  event.set(h_TAG__pTrel_pt030_eta2p4, tag__pTrel_pt030_eta2p4);
-  event.set(h_TAG__pTrel_pt050_eta2p4, tag__pTrel_pt050_eta2p4);
-
-  /* PROBE */
-  event.set(h_PRO__E                 , pro->v4().E());
-  event.set(h_PRO__pt                , pro->v4().Pt());
-  event.set(h_PRO__eta               , pro->v4().Eta());
-  event.set(h_PRO__etaSC             , pro__etaSC);
-  event.set(h_PRO__phi               , pro->v4().Phi());
-  event.set(h_PRO__charge            , int(pro->charge()));
-  event.set(h_PRO__pfIso_dbeta       , pro__pfIso_dbeta);
-  event.set(h_PRO__minDR_pt025       , pro__minDR_pt025);
-  event.set(h_PRO__minDR_pt030_eta2p4, pro__minDR_pt030_eta2p4);
-  event.set(h_PRO__minDR_pt050_eta2p4, pro__minDR_pt050_eta2p4);
-  event.set(h_PRO__pTrel_pt025       , pro__pTrel_pt025);
-  event.set(h_PRO__pTrel_pt030_eta2p4, pro__pTrel_pt030_eta2p4);
-  event.set(h_PRO__pTrel_pt050_eta2p4, pro__pTrel_pt050_eta2p4);
+  if(all_pairings) event.set(h_tnps, tnps);
+  else             event.set(h_tnp , tnps.front());
   ///
 
   return true;
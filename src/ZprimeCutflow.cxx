@@ -0,0 +1,420 @@
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeCutflow.h>
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <stdexcept>
+
+#include <UHH2/core/include/Utils.h>
+
+CutflowHists::CutflowHists(uhh2::Context& ctx, const std::string& dirname, const std::vector<std::string>& steps, const bool timing): uhh2::Hists(ctx, dirname){
+
+  const int nbins(steps.size()+1);
+
+  cutflow_raw  = book<TH1D>("cutflow_raw" , ";;events"         , nbins, 0, nbins);
+  cutflow_wgt  = book<TH1D>("cutflow_wgt" , ";;weighted events", nbins, 0, nbins);
+  cutflow_time = timing ? book<TH1D>("cutflow_time", ";;time in step [s]", nbins, 0, nbins) : 0;
+
+  for(auto* h : {cutflow_raw, cutflow_wgt, cutflow_time}){
+
+    if(!h) continue;
+
+    h->GetXaxis()->SetBinLabel(1, "input");
+    for(int i=0; i<int(steps.size()); ++i) h->GetXaxis()->SetBinLabel(i+2, steps.at(i).c_str());
+  }
+}
+
+void CutflowHists::count(const size_t bin, const double weight){
+
+  cutflow_raw->Fill(bin);
+  cutflow_wgt->Fill(bin, weight);
+
+  return;
+}
+
+void CutflowHists::time(const size_t bin, const double seconds){
+
+  if(cutflow_time) cutflow_time->Fill(bin, seconds);
+
+  return;
+}
+
+void CutflowHists::reset(const std::vector<std::string>& steps){
+
+  for(auto* h : {cutflow_raw, cutflow_wgt, cutflow_time}){
+
+    if(!h) continue;
+
+    h->Reset();
+    for(int i=0; i<int(steps.size()); ++i) h->GetXaxis()->SetBinLabel(i+2, steps.at(i).c_str());
+  }
+
+  return;
+}
+////////////////////////////////////////////////////////
+
+void Cutflow::add(const std::string& name, std::unique_ptr<uhh2::Selection> sel, std::unique_ptr<uhh2::Hists> hists,
+                  const std::vector<std::string>& sel_products, const std::vector<std::string>& hists_products){
+
+  if(counters_) throw std::runtime_error("Cutflow::add -- cutflow \""+name_+"\" already finalized, can not add step: "+name);
+  if(!sel)      throw std::runtime_error("Cutflow::add -- null Selection for step: "+name);
+
+  for(const auto& s : steps_){
+    if(s.name == name) throw std::runtime_error("Cutflow::add -- step already defined in cutflow \""+name_+"\": "+name);
+  }
+
+  Step step;
+  step.name  = name;
+  step.bin   = 0;
+  step.sel   = std::move(sel);
+  step.hists = std::move(hists);
+
+  if(!products_ && (!sel_products.empty() || !hists_products.empty()))
+    throw std::runtime_error("Cutflow::add -- products required by step \""+name+"\", but cutflow \""+name_+"\" has no ProductScheduler");
+
+  for(const auto& p : sel_products)   step.sel_products  .push_back(products_->id(p));
+  for(const auto& p : hists_products) step.hists_products.push_back(products_->id(p));
+
+  steps_.push_back(std::move(step));
+
+  return;
+}
+
+void Cutflow::finalize(uhh2::Context& ctx){
+
+  if(counters_) throw std::runtime_error("Cutflow::finalize -- cutflow \""+name_+"\" already finalized");
+
+  /* optional step order from xml: <Item Name="<name>__steps" Value="step1,step2,..."/> */
+  const std::string& steps_cfg = ctx.get(name_+"__steps", "");
+  if(steps_cfg != ""){
+
+    std::vector<Step> steps;
+
+    for(const auto& tok : uhh2::split(steps_cfg, ",")){
+
+      auto it = steps_.begin();
+      while(it != steps_.end() && it->name != tok) ++it;
+
+      if(it == steps_.end()) throw std::runtime_error("Cutflow::finalize -- step \""+tok+"\" (from xml key '"+name_+"__steps') not defined in cutflow \""+name_+"\"");
+      if(!it->sel)           throw std::runtime_error("Cutflow::finalize -- step \""+tok+"\" listed twice in xml key '"+name_+"__steps'");
+
+      steps.push_back(std::move(*it));
+    }
+
+    for(const auto& s : steps_){
+      if(s.sel) std::cout << "\n @@@ WARNING -- Cutflow::finalize -- step \"" << s.name << "\" of cutflow \"" << name_ << "\" disabled (not listed in xml key '" << name_ << "__steps')\n";
+    }
+
+    steps_ = std::move(steps);
+  }
+
+  std::vector<std::string> names;
+  for(size_t i=0; i<steps_.size(); ++i){
+
+    steps_[i].bin = i+1;
+    names.push_back(steps_[i].name);
+  }
+
+  /* optional timing of the steps: <Item Name="<name>__timing" Value="true"/> */
+  const std::string& timing = ctx.get(name_+"__timing", "false");
+  if(timing != "true" && timing != "false") throw std::runtime_error("Cutflow::finalize -- undefined argument for xml key '"+name_+"__timing' (must be 'true' or 'false'): "+timing);
+
+  counters_.reset(new CutflowHists(ctx, name_, names, timing == "true"));
+
+  /* adaptive step ordering: <Item Name="<name>__adaptive" Value="<N training events>"/> */
+  const int nevents = std::stoi(ctx.get(name_+"__adaptive", "0"));
+  if(nevents < 0) throw std::runtime_error("Cutflow::finalize -- negative number of training events for xml key '"+name_+"__adaptive'");
+
+  adaptive_nevents_ = nevents;
+  if(adaptive_nevents_ && !steps_.empty()){
+
+    train_weight_.reserve(adaptive_nevents_);
+    train_time_  .reserve(adaptive_nevents_*steps_.size());
+    train_pass_  .reserve(adaptive_nevents_*steps_.size());
+
+    if(products_){
+
+      train_ptime_.reserve(adaptive_nevents_*products_->size());
+
+      for(auto& step : steps_){
+
+        const std::vector<char> flags = products_->closure(step.sel_products);
+        for(size_t p=0; p<flags.size(); ++p) if(flags[p]) step.sel_closure.push_back(p);
+      }
+
+      products_->time_producers(true);
+    }
+
+    final_hists_          = steps_.back().hists.get();
+    final_hists_products_ = steps_.back().hists_products;
+
+    for(size_t i=0; i+1<steps_.size(); ++i){
+      if(steps_[i].hists) std::cout << "\n @@@ WARNING -- Cutflow::finalize -- adaptive cutflow \"" << name_ << "\": hists of intermediate step \"" << steps_[i].name << "\" disabled\n";
+    }
+  }
+
+  return;
+}
+
+bool Cutflow::process(uhh2::Event& event){
+
+  if(!counters_) throw std::runtime_error("Cutflow::process -- cutflow \""+name_+"\" not finalized");
+
+  counters_->count(0, event.weight);
+
+  if(adaptive_count_ < adaptive_nevents_) return process_training(event);
+
+  const bool timing(counters_->timing());
+
+  for(auto& step : steps_){
+
+    bool pass(false);
+    if(timing){
+
+      // products triggered by the step charged to it
+      const auto t0 = std::chrono::steady_clock::now();
+      require(event, step.sel_products);
+      pass = step.sel->passes(event);
+      const auto t1 = std::chrono::steady_clock::now();
+
+      counters_->time(step.bin, std::chrono::duration<double>(t1-t0).count());
+    }
+    else {
+
+      require(event, step.sel_products);
+      pass = step.sel->passes(event);
+    }
+
+    if(!pass) return false;
+
+    counters_->count(step.bin, event.weight);
+    if(!adaptive() && step.hists){ require(event, step.hists_products); step.hists->fill(event); }
+  }
+
+  if(adaptive() && final_hists_){ require(event, final_hists_products_); final_hists_->fill(event); }
+
+  return true;
+}
+
+bool Cutflow::process_training(uhh2::Event& event){
+
+  // products available before the cutflow: no cost for any step order
+  const size_t P(products_ ? products_->size() : 0);
+  std::vector<char> available(P);
+  for(size_t p=0; p<P; ++p) available[p] = products_->done(p);
+
+  bool pass_all(true);
+
+  for(size_t i=0; i<steps_.size(); ++i){
+
+    require(event, steps_[i].sel_products);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const bool pass = steps_[i].sel->passes(event);
+    const auto t1 = std::chrono::steady_clock::now();
+
+    train_time_.push_back(std::chrono::duration<double>(t1-t0).count());
+    train_pass_.push_back(pass);
+  }
+
+  for(size_t p=0; p<P; ++p) train_ptime_.push_back(available[p] ? 0. : products_->time(p));
+
+  train_weight_.push_back(event.weight);
+
+  // counters as for the short-circuited evaluation in the current order
+  const size_t e(train_weight_.size()-1);
+  std::vector<char> paid(P, 0);
+  for(size_t i=0; i<steps_.size(); ++i){
+
+    counters_->time(steps_[i].bin, train_cost(e, i, paid));
+
+    pass_all = train_pass_[e*steps_.size()+i];
+    if(!pass_all) break;
+
+    counters_->count(steps_[i].bin, event.weight);
+  }
+
+  if(pass_all && final_hists_){ require(event, final_hists_products_); final_hists_->fill(event); }
+
+  if(++adaptive_count_ == adaptive_nevents_) reorder();
+
+  return pass_all;
+}
+
+double Cutflow::train_cost(const size_t e, const size_t i, std::vector<char>& paid) const {
+
+  const size_t P(paid.size());
+
+  double cost = train_time_[e*steps_.size()+i];
+  for(const auto p : steps_[i].sel_closure){
+
+    if(paid[p]) continue;
+
+    cost += train_ptime_[e*P+p];
+    paid[p] = 1;
+  }
+
+  return cost;
+}
+
+void Cutflow::reorder(){
+
+  const size_t N(steps_.size());
+  const size_t P(products_ ? products_->size() : 0);
+  const double ntrain(adaptive_count_);
+
+  // expected cost per event of a given order: training events replayed short-circuited, products paid by their first consumer
+  std::vector<char> paid(P);
+  auto expected_cost = [&](const std::vector<size_t>& order){
+
+    double c(0.);
+    for(size_t e=0; e<adaptive_count_; ++e){
+
+      std::fill(paid.begin(), paid.end(), 0);
+      for(const auto i : order){
+
+        c += train_cost(e, i, paid);
+        if(!train_pass_[e*N+i]) break;
+      }
+    }
+
+    return c / ntrain;
+  };
+
+  std::vector<size_t> order(N);
+  std::iota(order.begin(), order.end(), 0);
+
+  const double cost_before = expected_cost(order);
+  double cost_after(cost_before);
+
+  if(N <= 7){
+
+    // all orders (configured order kept unless strictly cheaper)
+    std::vector<size_t> perm(order);
+    while(std::next_permutation(perm.begin(), perm.end())){
+
+      const double c = expected_cost(perm);
+      if(c < cost_after){ cost_after = c; order = perm; }
+    }
+  }
+  else {
+
+    // greedy: next step with the minimal (cost charged to it)/(events it rejects) over the events still selected
+    std::vector<char> alive(adaptive_count_, 1), used(N, 0);
+    std::vector<char> paid_evt(adaptive_count_*P, 0);
+    std::vector<char> tmp(P);
+
+    order.clear();
+    for(size_t k=0; k<N; ++k){
+
+      size_t best(N);
+      double best_rank(0.), best_cost(0.);
+      for(size_t i=0; i<N; ++i){
+
+        if(used[i]) continue;
+
+        double c(0.), rej(0.);
+        for(size_t e=0; e<adaptive_count_; ++e){
+
+          if(!alive[e]) continue;
+
+          std::copy(paid_evt.begin()+e*P, paid_evt.begin()+(e+1)*P, tmp.begin());
+          c += train_cost(e, i, tmp);
+          rej += !train_pass_[e*N+i];
+        }
+
+        const double rank = (rej > 0.) ? c / rej : std::numeric_limits<double>::infinity();
+        if(best == N || rank < best_rank || (rank == best_rank && c < best_cost)){ best = i; best_rank = rank; best_cost = c; }
+      }
+
+      used[best] = 1;
+      order.push_back(best);
+
+      for(size_t e=0; e<adaptive_count_; ++e){
+
+        if(!alive[e]) continue;
+
+        std::copy(paid_evt.begin()+e*P, paid_evt.begin()+(e+1)*P, tmp.begin());
+        train_cost(e, best, tmp);
+        std::copy(tmp.begin(), tmp.end(), paid_evt.begin()+e*P);
+
+        alive[e] = train_pass_[e*N+best];
+      }
+    }
+
+    cost_after = expected_cost(order);
+  }
+
+  // per-step charged cost (events reaching the step) and pass fraction in the new order, for the log
+  std::vector<double> cost(N, 0.), nreach(N, 0.), eff(N, 0.);
+  for(size_t e=0; e<adaptive_count_; ++e){
+
+    std::fill(paid.begin(), paid.end(), 0);
+    for(size_t k=0; k<N; ++k){
+
+      const size_t i(order[k]);
+      cost  [k] += train_cost(e, i, paid);
+      nreach[k] += 1.;
+      if(!train_pass_[e*N+i]) break;
+      eff   [k] += 1.;
+    }
+  }
+
+  // counters relabelled in the new order, training events recounted as short-circuited in it
+  // (done before moving the steps: train_cost indexes the steps in the configured order)
+  std::vector<std::string> names;
+  for(size_t k=0; k<N; ++k) names.push_back(steps_[order[k]].name);
+
+  counters_->reset(names);
+
+  for(size_t e=0; e<adaptive_count_; ++e){
+
+    counters_->count(0, train_weight_[e]);
+
+    std::fill(paid.begin(), paid.end(), 0);
+    for(size_t k=0; k<N; ++k){
+
+      const size_t i(order[k]);
+      counters_->time(k+1, train_cost(e, i, paid));
+
+      if(!train_pass_[e*N+i]) break;
+      counters_->count(k+1, train_weight_[e]);
+    }
+  }
+
+  std::vector<Step> steps;
+  for(const auto i : order) steps.push_back(std::move(steps_[i]));
+  steps_ = std::move(steps);
+
+  for(size_t k=0; k<N; ++k) steps_[k].bin = k+1;
+
+  std::cout << "\n @@@ Cutflow::reorder -- cutflow \"" << name_ << "\" (" << adaptive_count_ << " training events) -- new step order:\n";
+  for(size_t k=0; k<N; ++k){
+
+    std::cout << "     " << steps_[k].name << " [cost=" << (nreach[k] ? cost[k]/nreach[k] : 0.)*1.e6 << " us (products paid by the step included)"
+              << ", eff=" << (nreach[k] ? eff[k]/nreach[k] : 0.) << "]\n";
+  }
+  std::cout << "     expected cost per event: " << cost_before*1.e6 << " us -> " << cost_after*1.e6 << " us\n";
+
+  std::string steps_cfg;
+  for(size_t k=0; k<N; ++k) steps_cfg += (k ? "," : "")+steps_[k].name;
+  std::cout << "     step order for the production jobs: <Item Name=\"" << name_ << "__steps\" Value=\"" << steps_cfg << "\"/>\n";
+
+  if(products_ && N) products_->time_producers(false);
+
+  train_weight_.clear(); train_weight_.shrink_to_fit();
+  train_time_  .clear(); train_time_  .shrink_to_fit();
+  train_pass_  .clear(); train_pass_  .shrink_to_fit();
+  train_ptime_ .clear(); train_ptime_ .shrink_to_fit();
+
+  return;
+}
+
+void Cutflow::require(uhh2::Event& event, const std::vector<size_t>& products){
+
+  for(const auto p : products) products_->require(event, p);
+
+  return;
+}
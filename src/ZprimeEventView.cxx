@@ -0,0 +1,188 @@
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeEventView.h>
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <UHH2/core/include/Utils.h>
+
+void ParticleArrays::clear(){
+
+  pt    .clear();
+  eta   .clear();
+  phi   .clear();
+  m     .clear();
+  charge.clear();
+
+  return;
+}
+
+void ZprimeEventView::fill(const uhh2::Event& event){
+
+  assert(event.muons && event.electrons);
+  assert(event.jets && event.topjets && event.met);
+
+  muons    .fill(*event.muons);
+  electrons.fill(*event.electrons);
+  jets     .fill(*event.jets);
+  topjets  .fill(*event.topjets);
+
+  met_pt  = event.met->pt();
+  met_phi = event.met->phi();
+
+  return;
+}
+
+void ZprimeEventView::fill_leptons(const uhh2::Event& event){
+
+  assert(event.muons && event.electrons && event.met);
+
+  muons    .fill(*event.muons);
+  electrons.fill(*event.electrons);
+  jets     .clear();
+  topjets  .clear();
+
+  met_pt  = event.met->pt();
+  met_phi = event.met->phi();
+
+  return;
+}
+////////////////////////////////////////////////////////
+
+ZprimeEventViewProducer::ZprimeEventViewProducer(uhh2::Context& ctx, const std::string& label, const bool jets):
+  h_view_(ctx.get_handle<ZprimeEventView>(label)), jets_(jets), nfills_(0) {}
+
+bool ZprimeEventViewProducer::process(uhh2::Event& event){
+
+  if(jets_) view_.fill(event);
+  else      view_.fill_leptons(event);
+  view_.id = ++nfills_;
+  event.set(h_view_, view_);
+
+  return true;
+}
+////////////////////////////////////////////////////////
+
+float delta_phi(const float phi1, const float phi2){
+
+  float dphi = std::fabs(phi1 - phi2);
+  if(dphi > float(M_PI)) dphi = float(2*M_PI) - dphi;
+
+  return dphi;
+}
+
+std::pair<const ParticleArrays*, size_t> leading_lepton(const ZprimeEventView& view){
+
+  const ParticleArrays* coll(0);
+  size_t idx(0);
+
+  float ptL_max(0.);
+  for(size_t i=0; i<view.muons    .size(); ++i){ if(view.muons    .pt[i] > ptL_max){ ptL_max = view.muons    .pt[i]; coll = &view.muons;     idx = i; } }
+  for(size_t i=0; i<view.electrons.size(); ++i){ if(view.electrons.pt[i] > ptL_max){ ptL_max = view.electrons.pt[i]; coll = &view.electrons; idx = i; } }
+
+  return std::make_pair(coll, idx);
+}
+
+float pTrel(const float pt, const float eta, const float phi, const float jet_eta, const float jet_phi){
+
+  // pTrel = |p x p_jet| / |p_jet|
+  const float px(pt*std::cos(phi))    , py(pt*std::sin(phi))    , pz(pt*std::sinh(eta));
+  const float jx(std::cos(jet_phi))   , jy(std::sin(jet_phi))   , jz(std::sinh(jet_eta));
+
+  const float cx(py*jz - pz*jy), cy(pz*jx - px*jz), cz(px*jy - py*jx);
+
+  return std::sqrt((cx*cx + cy*cy + cz*cz) / (jx*jx + jy*jy + jz*jz));
+}
+
+std::pair<float, float> drmin_pTrel(const float pt, const float eta, const float phi, const ParticleArrays& jets){
+
+  float drmin2(std::numeric_limits<float>::infinity());
+  size_t ij(jets.size());
+
+  for(size_t i=0; i<jets.size(); ++i){
+
+    const float deta = eta - jets.eta[i];
+    const float dphi = delta_phi(phi, jets.phi[i]);
+    const float dr2  = deta*deta + dphi*dphi;
+
+    if(dr2 < drmin2){ drmin2 = dr2; ij = i; }
+  }
+
+  if(ij == jets.size()) return std::make_pair(999., 999.);
+
+  return std::make_pair(std::sqrt(drmin2), pTrel(pt, eta, phi, jets.eta[ij], jets.phi[ij]));
+}
+
+float drmin(const float eta, const float phi, const ParticleArrays& coll){
+
+  float drmin2(std::numeric_limits<float>::infinity());
+
+  for(size_t i=0; i<coll.size(); ++i){
+
+    const float deta = eta - coll.eta[i];
+    const float dphi = delta_phi(phi, coll.phi[i]);
+
+    drmin2 = std::min(drmin2, deta*deta + dphi*dphi);
+  }
+
+  return std::sqrt(drmin2);
+}
+////////////////////////////////////////////////////////
+
+JetWorkingPointSweep::JetWorkingPointSweep(const std::vector<std::pair<float, float>>& wps): wps_(wps) {
+
+  if(wps_.empty()) throw std::runtime_error("JetWorkingPointSweep::JetWorkingPointSweep -- empty list of jet working points");
+
+  njets_.assign(wps_.size(), 0);
+}
+
+void JetWorkingPointSweep::run(const ParticleArrays& jets, const ParticleArrays& leptons){
+
+  const size_t nwp(wps_.size()), nlep(leptons.size());
+
+  std::fill(njets_.begin(), njets_.end(), 0);
+
+  drmin2_.assign(nlep*nwp, std::numeric_limits<float>::infinity());
+  closest_.assign(nlep*nwp, jets.size());
+
+  // single sweep over the jets: working points passed by each jet, closest passing jet of each lepton
+  for(size_t j=0; j<jets.size(); ++j){
+
+    const float pt(jets.pt[j]), abseta(std::fabs(jets.eta[j]));
+
+    for(size_t w=0; w<nwp; ++w){
+
+      if(!(pt > wps_[w].first && abseta < wps_[w].second)) continue;
+
+      ++njets_[w];
+
+      for(size_t l=0; l<nlep; ++l){
+
+        const float deta = leptons.eta[l] - jets.eta[j];
+        const float dphi = delta_phi(leptons.phi[l], jets.phi[j]);
+        const float dr2  = deta*deta + dphi*dphi;
+
+        if(dr2 < drmin2_[l*nwp+w]){ drmin2_[l*nwp+w] = dr2; closest_[l*nwp+w] = j; }
+      }
+    }
+  }
+
+  // (minDR, pTrel) wrt the closest jet [(999, 999) if no jet passes the working point, as drmin_pTrel]
+  minDR_.assign(nlep*nwp, 999.);
+  pTrel_.assign(nlep*nwp, 999.);
+
+  for(size_t l=0; l<nlep; ++l){
+    for(size_t w=0; w<nwp; ++w){
+
+      const size_t j = closest_[l*nwp+w];
+      if(j == jets.size()) continue;
+
+      minDR_[l*nwp+w] = std::sqrt(drmin2_[l*nwp+w]);
+      pTrel_[l*nwp+w] = ::pTrel(leptons.pt[l], leptons.eta[l], leptons.phi[l], jets.eta[j], jets.phi[j]);
+    }
+  }
+
+  return;
+}
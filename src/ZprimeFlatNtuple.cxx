@@ -0,0 +1,447 @@
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeFlatNtuple.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <UHH2/core/include/Utils.h>
+
+float truncate_mantissa(const float f, const int bits){
+
+  if(bits >= 23 || !std::isfinite(f)) return f;
+
+  uint32_t x;
+  std::memcpy(&x, &f, 4);
+
+  const int drop = 23 - bits;
+  x = (x + (1u << (drop-1))) & ~((1u << drop) - 1); // round to nearest (carry into the exponent if needed)
+
+  float r;
+  std::memcpy(&r, &x, 4);
+
+  return r;
+}
+
+uint16_t float_to_half(const float f){
+
+  uint32_t x;
+  std::memcpy(&x, &f, 4);
+
+  const uint16_t sign = (x >> 16) & 0x8000;
+  const uint32_t fexp = (x >> 23) & 0xff;
+  uint32_t mant = x & 0x7fffff;
+
+  if(fexp == 0xff) return sign | 0x7c00 | (mant ? 0x200 : 0); // inf, nan
+
+  const int exp = int(fexp) - 127 + 15;
+  if(exp >= 31) return sign | 0x7c00; // overflow
+
+  // subnormal half
+  if(exp <= 0){
+
+    if(exp < -10) return sign;
+
+    mant |= 0x800000;
+    const int shift = 14 - exp;
+
+    uint32_t h = mant >> shift;
+    const uint32_t rem = mant & ((1u << shift) - 1), halfway = 1u << (shift-1);
+    if(rem > halfway || (rem == halfway && (h & 1))) ++h;
+
+    return sign | h;
+  }
+
+  uint32_t h = (uint32_t(exp) << 10) | (mant >> 13);
+  const uint32_t rem = mant & 0x1fff;
+  if(rem > 0x1000 || (rem == 0x1000 && (h & 1))) ++h; // carry into the exponent (up to inf) if needed
+
+  return sign | h;
+}
+
+float half_to_float(const uint16_t h){
+
+  const uint32_t sign = uint32_t(h & 0x8000) << 16;
+  uint32_t exp = (h >> 10) & 0x1f, mant = h & 0x3ff, x;
+
+  if(exp == 0){
+
+    if(!mant) x = sign;
+    else {
+
+      // subnormal half: normalized float
+      exp = 127 - 15 + 1;
+      while(!(mant & 0x400)){ mant <<= 1; --exp; }
+
+      x = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+  }
+  else if(exp == 31) x = sign | 0x7f800000 | (mant << 13);
+  else               x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+
+  float f;
+  std::memcpy(&f, &x, 4);
+
+  return f;
+}
+////////////////////////////////////////////////////////
+
+FlatPrecision::FlatPrecision(const std::string& cfg){
+
+  if(cfg == "") return;
+
+  for(const auto& item : uhh2::split(cfg, ",")){
+
+    const auto fields = uhh2::split(item, ":");
+    if(fields.size() != 2) throw std::runtime_error("FlatPrecision::FlatPrecision -- invalid column precision (must be 'variable:precision'): "+item);
+
+    Spec spec;
+
+    const std::string& p = fields.at(1);
+    if     (p == "full") spec.t = full;
+    else if(p == "f16" ) spec.t = half;
+    else if(p.size() > 1 && p[0] == 'm'){
+
+      spec.t = mantissa;
+      spec.bits = std::stoi(p.substr(1));
+      if(spec.bits < 0 || spec.bits > 23) throw std::runtime_error("FlatPrecision::FlatPrecision -- number of mantissa bits out of range [0, 23]: "+item);
+    }
+    else throw std::runtime_error("FlatPrecision::FlatPrecision -- undefined precision (must be 'full', 'mN' or 'f16'): "+item);
+
+    specs_[fields.at(0)] = spec;
+  }
+}
+
+const FlatPrecision::Spec& FlatPrecision::get(const std::string& var) const {
+
+  const auto it = specs_.find(var);
+
+  return it != specs_.end() ? it->second : default_;
+}
+////////////////////////////////////////////////////////
+
+FlatColumn::FlatColumn(uhh2::Context& ctx, const std::string& name, const FlatPrecision::Spec& spec, const bool output): spec_(spec) {
+
+  if(spec_.t == FlatPrecision::half){
+
+    if(output) h_half_ = ctx.declare_event_output<std::vector<uint16_t>>(name+"__f16");
+    else       h_half_ = ctx.declare_event_input <std::vector<uint16_t>>(name+"__f16");
+  }
+  else {
+
+    if(output) h_float_ = ctx.declare_event_output<std::vector<float>>(name);
+    else       h_float_ = ctx.declare_event_input <std::vector<float>>(name);
+  }
+}
+
+void FlatColumn::put(uhh2::Event& event, const std::vector<float>& vals){
+
+  if(spec_.t == FlatPrecision::half){
+
+    half_.resize(vals.size());
+    for(size_t i=0; i<vals.size(); ++i) half_[i] = float_to_half(vals[i]);
+
+    event.set(h_half_, half_);
+  }
+  else if(spec_.t == FlatPrecision::mantissa){
+
+    buf_.resize(vals.size());
+    for(size_t i=0; i<vals.size(); ++i) buf_[i] = truncate_mantissa(vals[i], spec_.bits);
+
+    event.set(h_float_, buf_);
+  }
+  else event.set(h_float_, vals);
+
+  return;
+}
+
+const std::vector<float>& FlatColumn::get(const uhh2::Event& event){
+
+  if(spec_.t != FlatPrecision::half) return event.get(h_float_);
+
+  const std::vector<uint16_t>& vals = event.get(h_half_);
+
+  buf_.resize(vals.size());
+  for(size_t i=0; i<vals.size(); ++i) buf_[i] = half_to_float(vals[i]);
+
+  return buf_;
+}
+////////////////////////////////////////////////////////
+
+FlatParticleColumns::FlatParticleColumns(uhh2::Context& ctx, const std::string& prefix, const FlatPrecision& prec, const bool output, const bool charge):
+  pt_vals_(0), eta_vals_(0), phi_vals_(0), m_vals_(0), charge_vals_(0) {
+
+  pt_ .reset(new FlatColumn(ctx, prefix+"__pt" , prec.get("pt") , output));
+  eta_.reset(new FlatColumn(ctx, prefix+"__eta", prec.get("eta"), output));
+  phi_.reset(new FlatColumn(ctx, prefix+"__phi", prec.get("phi"), output));
+  m_  .reset(new FlatColumn(ctx, prefix+"__m"  , prec.get("m")  , output));
+
+  if(charge) charge_.reset(new FlatColumn(ctx, prefix+"__charge", prec.get("charge"), output));
+}
+
+void FlatParticleColumns::clear(){
+
+  pt_buf_.clear(); eta_buf_.clear(); phi_buf_.clear(); m_buf_.clear(); charge_buf_.clear();
+
+  return;
+}
+
+void FlatParticleColumns::add(const LorentzVector& p4, const float charge){
+
+  pt_buf_ .push_back(p4.pt());
+  eta_buf_.push_back(p4.eta());
+  phi_buf_.push_back(p4.phi());
+  m_buf_  .push_back(p4.M());
+
+  if(charge_) charge_buf_.push_back(charge);
+
+  return;
+}
+
+void FlatParticleColumns::put(uhh2::Event& event){
+
+  pt_ ->put(event, pt_buf_);
+  eta_->put(event, eta_buf_);
+  phi_->put(event, phi_buf_);
+  m_  ->put(event, m_buf_);
+
+  if(charge_) charge_->put(event, charge_buf_);
+
+  return;
+}
+
+size_t FlatParticleColumns::get(const uhh2::Event& event){
+
+  pt_vals_  = &pt_ ->get(event);
+  eta_vals_ = &eta_->get(event);
+  phi_vals_ = &phi_->get(event);
+  m_vals_   = &m_  ->get(event);
+
+  if(charge_) charge_vals_ = &charge_->get(event);
+
+  const size_t n = pt_vals_->size();
+  if(eta_vals_->size() != n || phi_vals_->size() != n || m_vals_->size() != n || (charge_ && charge_vals_->size() != n))
+    throw std::runtime_error("FlatParticleColumns::get -- columns of the same collection with different sizes");
+
+  return n;
+}
+
+LorentzVector FlatParticleColumns::v4(const size_t i) const {
+
+  const double pt((*pt_vals_)[i]), eta((*eta_vals_)[i]), m((*m_vals_)[i]);
+
+  // energy from |p| and the (signed, as from LorentzVector::M) mass
+  const double p = pt * std::cosh(eta);
+  const double e2 = p*p + m*std::fabs(m);
+
+  return LorentzVector(pt, eta, (*phi_vals_)[i], std::sqrt(e2 > 0. ? e2 : 0.));
+}
+////////////////////////////////////////////////////////
+
+FlatNtupleWriter::FlatNtupleWriter(uhh2::Context& ctx, const std::string& hyps, const FlatPrecision& prec, const std::vector<std::string>& discriminators):
+  muons_          (ctx, "flat__muons"          , prec, true, true),
+  electrons_      (ctx, "flat__electrons"      , prec, true, true),
+  jets_           (ctx, "flat__jets"           , prec, true),
+  topjets_        (ctx, "flat__topjets"        , prec, true),
+  hyp_lepton_     (ctx, "flat__hyp__lepton"    , prec, true, true),
+  hyp_neutrino_   (ctx, "flat__hyp__neutrino"  , prec, true),
+  hyp_tophad_     (ctx, "flat__hyp__tophad"    , prec, true),
+  hyp_toplep_     (ctx, "flat__hyp__toplep"    , prec, true),
+  hyp_tophad_jets_(ctx, "flat__hyp__tophad_jets", prec, true),
+  hyp_toplep_jets_(ctx, "flat__hyp__toplep_jets", prec, true),
+  discriminators_(discriminators) {
+
+  jets_btag_.reset(new FlatColumn(ctx, "flat__jets__btag", prec.get("btag"), true));
+  met_pt_   .reset(new FlatColumn(ctx, "flat__met__pt"   , prec.get("pt")  , true));
+  met_phi_  .reset(new FlatColumn(ctx, "flat__met__phi"  , prec.get("phi") , true));
+  pvN_      .reset(new FlatColumn(ctx, "flat__pvN"       , FlatPrecision::Spec(), true));
+
+  hyp_tophad_jets_n_.reset(new FlatColumn(ctx, "flat__hyp__tophad_jets__n", FlatPrecision::Spec(), true));
+  hyp_toplep_jets_n_.reset(new FlatColumn(ctx, "flat__hyp__toplep_jets__n", FlatPrecision::Spec(), true));
+
+  for(const auto& disc : discriminators_) hyp_disc_.emplace_back(new FlatColumn(ctx, "flat__hyp__"+disc, prec.get("discriminator"), true));
+
+  h_hyps_ = ctx.get_handle<std::vector<ReconstructionHypothesis>>(hyps);
+}
+
+bool FlatNtupleWriter::process(uhh2::Event& event){
+
+  assert(event.muons && event.electrons && event.jets && event.topjets && event.met && event.pvs);
+
+  // collections
+  muons_.clear();
+  for(const auto& mu : *event.muons) muons_.add(mu.v4(), mu.charge());
+  muons_.put(event);
+
+  electrons_.clear();
+  for(const auto& el : *event.electrons) electrons_.add(el.v4(), el.charge());
+  electrons_.put(event);
+
+  jets_.clear();
+  buf_.clear();
+  for(const auto& jet : *event.jets){ jets_.add(jet.v4()); buf_.push_back(jet.btag_combinedSecondaryVertex()); }
+  jets_.put(event);
+  jets_btag_->put(event, buf_);
+
+  topjets_.clear();
+  for(const auto& topjet : *event.topjets) topjets_.add(topjet.v4());
+  topjets_.put(event);
+
+  met_pt_ ->put(event, std::vector<float>(1, event.met->pt()));
+  met_phi_->put(event, std::vector<float>(1, event.met->phi()));
+  pvN_    ->put(event, std::vector<float>(1, event.pvs->size()));
+
+  // ttbar hypotheses
+  const std::vector<ReconstructionHypothesis>& hyps = event.get(h_hyps_);
+
+  hyp_lepton_.clear(); hyp_neutrino_.clear(); hyp_tophad_.clear(); hyp_toplep_.clear();
+  hyp_tophad_jets_.clear(); hyp_toplep_jets_.clear();
+
+  std::vector<float> tophad_jets_n, toplep_jets_n;
+
+  for(const auto& hyp : hyps){
+
+    hyp_lepton_  .add(hyp.lepton().v4(), hyp.lepton().charge());
+    hyp_neutrino_.add(hyp.neutrino_v4());
+    hyp_tophad_  .add(hyp.tophad_v4());
+    hyp_toplep_  .add(hyp.toplep_v4());
+
+    for(const auto& j : hyp.tophad_jets()) hyp_tophad_jets_.add(j.v4());
+    for(const auto& j : hyp.toplep_jets()) hyp_toplep_jets_.add(j.v4());
+
+    tophad_jets_n.push_back(hyp.tophad_jets().size());
+    toplep_jets_n.push_back(hyp.toplep_jets().size());
+  }
+
+  hyp_lepton_.put(event); hyp_neutrino_.put(event); hyp_tophad_.put(event); hyp_toplep_.put(event);
+  hyp_tophad_jets_.put(event); hyp_toplep_jets_.put(event);
+
+  hyp_tophad_jets_n_->put(event, tophad_jets_n);
+  hyp_toplep_jets_n_->put(event, toplep_jets_n);
+
+  for(size_t d=0; d<discriminators_.size(); ++d){
+
+    buf_.clear();
+    for(const auto& hyp : hyps) buf_.push_back(hyp.has_discriminator(discriminators_[d]) ? hyp.discriminator(discriminators_[d]) : std::numeric_limits<float>::quiet_NaN());
+
+    hyp_disc_[d]->put(event, buf_);
+  }
+
+  return true;
+}
+////////////////////////////////////////////////////////
+
+FlatNtupleReader::FlatNtupleReader(uhh2::Context& ctx, const std::string& hyps, const FlatPrecision& prec, const std::vector<std::string>& discriminators):
+  muons_          (ctx, "flat__muons"          , prec, false, true),
+  electrons_      (ctx, "flat__electrons"      , prec, false, true),
+  jets_           (ctx, "flat__jets"           , prec, false),
+  topjets_        (ctx, "flat__topjets"        , prec, false),
+  hyp_lepton_     (ctx, "flat__hyp__lepton"    , prec, false, true),
+  hyp_neutrino_   (ctx, "flat__hyp__neutrino"  , prec, false),
+  hyp_tophad_     (ctx, "flat__hyp__tophad"    , prec, false),
+  hyp_toplep_     (ctx, "flat__hyp__toplep"    , prec, false),
+  hyp_tophad_jets_(ctx, "flat__hyp__tophad_jets", prec, false),
+  hyp_toplep_jets_(ctx, "flat__hyp__toplep_jets", prec, false),
+  discriminators_(discriminators) {
+
+  jets_btag_.reset(new FlatColumn(ctx, "flat__jets__btag", prec.get("btag"), false));
+  met_pt_   .reset(new FlatColumn(ctx, "flat__met__pt"   , prec.get("pt")  , false));
+  met_phi_  .reset(new FlatColumn(ctx, "flat__met__phi"  , prec.get("phi") , false));
+  pvN_      .reset(new FlatColumn(ctx, "flat__pvN"       , FlatPrecision::Spec(), false));
+
+  hyp_tophad_jets_n_.reset(new FlatColumn(ctx, "flat__hyp__tophad_jets__n", FlatPrecision::Spec(), false));
+  hyp_toplep_jets_n_.reset(new FlatColumn(ctx, "flat__hyp__toplep_jets__n", FlatPrecision::Spec(), false));
+
+  for(const auto& disc : discriminators_) hyp_disc_.emplace_back(new FlatColumn(ctx, "flat__hyp__"+disc, prec.get("discriminator"), false));
+
+  h_hyps_ = ctx.get_handle<std::vector<ReconstructionHypothesis>>(hyps);
+}
+
+bool FlatNtupleReader::process(uhh2::Event& event){
+
+  // collections
+  muons.resize(muons_.get(event));
+  for(size_t i=0; i<muons.size(); ++i){ muons[i] = Muon(); muons[i].set_v4(muons_.v4(i)); muons[i].set_charge(muons_.charge(i)); }
+
+  electrons.resize(electrons_.get(event));
+  for(size_t i=0; i<electrons.size(); ++i){ electrons[i] = Electron(); electrons[i].set_v4(electrons_.v4(i)); electrons[i].set_charge(electrons_.charge(i)); }
+
+  jets.resize(jets_.get(event));
+  const std::vector<float>& btag = jets_btag_->get(event);
+  if(btag.size() != jets.size()) throw std::runtime_error("FlatNtupleReader::process -- columns of the same collection with different sizes");
+  for(size_t i=0; i<jets.size(); ++i){ jets[i] = Jet(); jets[i].set_v4(jets_.v4(i)); jets[i].set_btag_combinedSecondaryVertex(btag[i]); }
+
+  topjets.resize(topjets_.get(event));
+  for(size_t i=0; i<topjets.size(); ++i){ topjets[i] = TopJet(); topjets[i].set_v4(topjets_.v4(i)); }
+
+  const std::vector<float>& met_pt  = met_pt_ ->get(event);
+  const std::vector<float>& met_phi = met_phi_->get(event);
+  const std::vector<float>& pvN     = pvN_    ->get(event);
+  if(met_pt.size() != 1 || met_phi.size() != 1 || pvN.size() != 1) throw std::runtime_error("FlatNtupleReader::process -- invalid size of event-level column");
+
+  met = MET();
+  met.set_pt (met_pt [0]);
+  met.set_phi(met_phi[0]);
+
+  pvs.resize(size_t(pvN[0]));
+
+  event.muons     = &muons;
+  event.electrons = &electrons;
+  event.jets      = &jets;
+  event.topjets   = &topjets;
+  event.met       = &met;
+  event.pvs       = &pvs;
+
+  // ttbar hypotheses
+  const size_t nhyps = hyp_lepton_.get(event);
+  if(hyp_neutrino_.get(event) != nhyps || hyp_tophad_.get(event) != nhyps || hyp_toplep_.get(event) != nhyps)
+    throw std::runtime_error("FlatNtupleReader::process -- columns of the ttbar hypotheses with different sizes");
+
+  const size_t ntophad_jets = hyp_tophad_jets_.get(event);
+  const size_t ntoplep_jets = hyp_toplep_jets_.get(event);
+
+  const std::vector<float>& tophad_jets_n = hyp_tophad_jets_n_->get(event);
+  const std::vector<float>& toplep_jets_n = hyp_toplep_jets_n_->get(event);
+  if(tophad_jets_n.size() != nhyps || toplep_jets_n.size() != nhyps) throw std::runtime_error("FlatNtupleReader::process -- columns of the ttbar hypotheses with different sizes");
+
+  size_t sum_tophad(0), sum_toplep(0);
+  for(size_t h=0; h<nhyps; ++h){ sum_tophad += size_t(tophad_jets_n[h]); sum_toplep += size_t(toplep_jets_n[h]); }
+  if(sum_tophad != ntophad_jets || sum_toplep != ntoplep_jets) throw std::runtime_error("FlatNtupleReader::process -- jets of the ttbar hypotheses inconsistent with the per-hypothesis counts");
+
+  std::vector<const std::vector<float>*> discs;
+  for(const auto& col : hyp_disc_){
+
+    discs.push_back(&col->get(event));
+    if(discs.back()->size() != nhyps) throw std::runtime_error("FlatNtupleReader::process -- columns of the ttbar hypotheses with different sizes");
+  }
+
+  std::vector<ReconstructionHypothesis> hyps(nhyps);
+
+  size_t jhad(0), jlep(0);
+  for(size_t h=0; h<nhyps; ++h){
+
+    ReconstructionHypothesis& hyp = hyps[h];
+
+    Particle lepton;
+    lepton.set_v4(hyp_lepton_.v4(h));
+    lepton.set_charge(hyp_lepton_.charge(h));
+
+    hyp.set_lepton(lepton);
+    hyp.set_neutrino_v4(hyp_neutrino_.v4(h));
+    hyp.set_tophad_v4(hyp_tophad_.v4(h));
+    hyp.set_toplep_v4(hyp_toplep_.v4(h));
+
+    for(size_t k=0; k<size_t(tophad_jets_n[h]); ++k, ++jhad){ Particle j; j.set_v4(hyp_tophad_jets_.v4(jhad)); hyp.add_tophad_jet(j); }
+    for(size_t k=0; k<size_t(toplep_jets_n[h]); ++k, ++jlep){ Particle j; j.set_v4(hyp_toplep_jets_.v4(jlep)); hyp.add_toplep_jet(j); }
+
+    for(size_t d=0; d<discriminators_.size(); ++d){
+
+      const float val = (*discs[d])[h];
+      if(!std::isnan(val)) hyp.set_discriminator(discriminators_[d], val);
+    }
+  }
+
+  event.set(h_hyps_, std::move(hyps));
+
+  return true;
+}
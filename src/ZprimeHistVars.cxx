@@ -0,0 +1,201 @@
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeHistVars.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+
+#include <TH1F.h>
+#include <TH2F.h>
+
+void ZprimeEventVars::fill(const uhh2::Event& event, const ZprimeEventView& view, const LeptonSummary* lepsum){
+
+  assert(event.pvs);
+
+  std::fill(set, set+nvars, false);
+
+  auto put = [this](const int i, const double v){ val[i] = v; set[i] = true; };
+
+  put(weight, event.weight);
+  put(pvN   , event.pvs->size());
+
+  // MUON, ELECTRON: kinematics and isolation wrt (top)jets of the two pt-leading leptons
+  const int lep_vars[2][2] = {{muo1__pt, muo2__pt}, {ele1__pt, ele2__pt}};
+  const ParticleArrays* leps[2] = {&view.muons, &view.electrons};
+
+  put(muoN, view.muons    .size());
+  put(eleN, view.electrons.size());
+
+  for(int l=0; l<2; ++l){
+
+    const ParticleArrays& lep = *leps[l];
+
+    for(int i=0; i<std::min(2, int(lep.size())); ++i){
+
+      float minDR_jet(-1.), pTrel_jet(-1.);
+      std::tie(minDR_jet, pTrel_jet) = drmin_pTrel(lep.pt[i], lep.eta[i], lep.phi[i], view.jets);
+
+      // variables of each lepton ordered as: pt, eta, minDR_jet, pTrel_jet, minDR_topjet
+      const int v0 = lep_vars[l][i];
+      put(v0  , lep.pt[i]);
+      put(v0+1, lep.eta[i]);
+      put(v0+2, minDR_jet);
+      put(v0+3, pTrel_jet);
+      put(v0+4, drmin(lep.eta[i], lep.phi[i], view.topjets));
+    }
+  }
+
+  // JET
+  const int jet_n(view.jets.size());
+  put(jetN, jet_n);
+
+  if(jet_n > 0){ put(jet1__pt, view.jets.pt[0]); put(jet1__eta, view.jets.eta[0]); }
+  if(jet_n > 1){ put(jet2__pt, view.jets.pt[1]); put(jet2__eta, view.jets.eta[1]); }
+  if(jet_n > 2){ put(jet3__pt, view.jets.pt[2]); put(jet3__eta, view.jets.eta[2]); }
+
+  // TOPJET
+  const int topjet_n(view.topjets.size());
+  put(topjetN, topjet_n);
+
+  if(topjet_n > 0){ put(topjet1__pt, view.topjets.pt[0]); put(topjet1__eta, view.topjets.eta[0]); }
+  if(topjet_n > 1){ put(topjet2__pt, view.topjets.pt[1]); put(topjet2__eta, view.topjets.eta[1]); }
+
+  // MET
+  put(met__pt , view.met_pt);
+  put(met__phi, view.met_phi);
+
+  // pt-leading lepton (from LeptonSummary, if available)
+  bool lep1(false);
+  float lep1_pt(0.), lep1_phi(0.);
+  if(lepsum){
+
+    lep1 = bool(lepsum->lep1);
+    lep1_pt  = lepsum->lep1_pt;
+    lep1_phi = lepsum->lep1_phi;
+  }
+  else {
+
+    const auto l1 = leading_lepton(view);
+    lep1 = bool(l1.first);
+    if(lep1){ lep1_pt = l1.first->pt[l1.second]; lep1_phi = l1.first->phi[l1.second]; }
+  }
+
+  if(lep1){
+
+    put(htlep__pt    , view.met_pt+lep1_pt);
+    put(dphi_met_lep1, delta_phi(view.met_phi, lep1_phi));
+  }
+
+  if(jet_n) put(dphi_met_jet1, delta_phi(view.met_phi, view.jets.phi[0]));
+
+  view_id = view.id;
+
+  return;
+}
+
+bool ZprimeEventVars::jet_dependent(const int var){
+
+  switch(var){
+
+    case muo1__minDR_jet: case muo1__pTrel_jet: case muo1__minDR_topjet:
+    case muo2__minDR_jet: case muo2__pTrel_jet: case muo2__minDR_topjet:
+    case ele1__minDR_jet: case ele1__pTrel_jet: case ele1__minDR_topjet:
+    case ele2__minDR_jet: case ele2__pTrel_jet: case ele2__minDR_topjet:
+    case jetN: case jet1__pt: case jet1__eta: case jet2__pt: case jet2__eta: case jet3__pt: case jet3__eta:
+    case topjetN: case topjet1__pt: case topjet1__eta: case topjet2__pt: case topjet2__eta:
+    case dphi_met_jet1:
+      return true;
+
+    default:
+      return false;
+  }
+}
+////////////////////////////////////////////////////////
+
+ZprimeEventVarsProducer::ZprimeEventVarsProducer(uhh2::Context& ctx, const std::string& view, const std::string& lepsum):
+  h_view_  (ctx.get_handle<ZprimeEventView>(view)),
+  h_lepsum_(ctx.get_handle<LeptonSummary>(lepsum)),
+  h_vars_  (ctx.get_handle<ZprimeEventVars>(view+"__vars")) {}
+
+bool ZprimeEventVarsProducer::process(uhh2::Event& event){
+
+  const LeptonSummary* lepsum = event.is_valid(h_lepsum_) ? &event.get(h_lepsum_) : 0;
+
+  vars_.fill(event, event.get(h_view_), lepsum);
+  event.set(h_vars_, vars_);
+
+  return true;
+}
+////////////////////////////////////////////////////////
+
+ZprimeTableHists::ZprimeTableHists(uhh2::Context& ctx, const std::string& dirname, const bool lep2, const std::string& view, const std::string& lepsum, const bool jets):
+  uhh2::Hists(ctx, dirname), jets_(jets) {
+
+  h_view_   = ctx.get_handle<ZprimeEventView>(view);
+  h_lepsum_ = ctx.get_handle<LeptonSummary>(lepsum);
+  h_vars_   = ctx.get_handle<ZprimeEventVars>(view+"__vars");
+
+  for(const auto& d : zprime_hists){
+
+    const bool jet_var = ZprimeEventVars::jet_dependent(d.varx) || (d.nbinsy && ZprimeEventVars::jet_dependent(d.vary));
+
+    if((d.lep2 && !lep2) || (jet_var && !jets_)) continue;
+
+    TH1* h(0);
+    if(!d.nbinsy) h = book<TH1F>(d.name, d.title, d.nbinsx, d.xmin, d.xmax);
+    else          h = book<TH2F>(d.name, d.title, d.nbinsx, d.xmin, d.xmax, d.nbinsy, d.ymin, d.ymax);
+
+    // sum of squared weights as created by TH1::Fill at the first non-unit weight
+    if(d.weighted && !h->GetSumw2N()) h->Sumw2();
+
+    TArrayF* content = dynamic_cast<TArrayF*>(h);
+    if(!content) throw std::runtime_error("ZprimeTableHists::ZprimeTableHists -- booked histogram is not a TH1F/TH2F: "+std::string(d.name));
+
+    hists_.push_back({&d, h, content->GetArray(), h->GetSumw2N() ? h->GetSumw2()->GetArray() : 0});
+  }
+}
+
+void ZprimeTableHists::fill(const uhh2::Event& event){
+
+  assert(event.pvs && event.muons && event.electrons);
+  assert(event.jets && event.topjets && event.met);
+
+  // SoA kinematics (event product, or built locally before it is available, e.g. for the input hists)
+  const ZprimeEventView* view(0);
+  if(event.is_valid(h_view_)) view = &event.get(h_view_);
+  else {
+
+    if(jets_) view_.fill(event);
+    else      view_.fill_leptons(event);
+
+    view = &view_;
+  }
+
+  // variables: shared event record if computed from the current view content, local record otherwise
+  const ZprimeEventVars* vars(0);
+  if(view->id && event.is_valid(h_vars_) && event.get(h_vars_).view_id == view->id) vars = &event.get(h_vars_);
+  else {
+
+    vars_.fill(event, *view, event.is_valid(h_lepsum_) ? &event.get(h_lepsum_) : 0);
+    vars = &vars_;
+  }
+
+  const double weight = event.weight;
+
+  for(auto& t : hists_){
+
+    const ZprimeHistDescriptor& d = *t.d;
+    if(!vars->set[d.varx] || (d.nbinsy && !vars->set[d.vary])) continue;
+
+    int bin = zprime_fixbin(vars->val[d.varx], d.nbinsx, d.xmin, d.xmax);
+    if(d.nbinsy) bin += (d.nbinsx+2) * zprime_fixbin(vars->val[d.vary], d.nbinsy, d.ymin, d.ymax);
+
+    const double w = d.weighted ? weight : 1.;
+
+    t.sumw[bin] += w;
+    if(t.sumw2) t.sumw2[bin] += w*w;
+
+    t.h->SetEntries(t.h->GetEntries() + 1);
+  }
+
+  return;
+}
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include <UHH2/core/include/AnalysisModule.h>
 #include <UHH2/core/include/Event.h>
@@ -9,16 +10,47 @@
 #include <UHH2/common/include/NSelections.h>
 #include <UHH2/common/include/ObjectIdUtils.h>
 #include <UHH2/common/include/JetIds.h>
+#include <UHH2/common/include/TopJetIds.h>
+#include <UHH2/common/include/TTbarReconstruction.h>
 #include <UHH2/common/include/ReconstructionHypothesisDiscriminators.h>
 #include <UHH2/common/include/HypothesisHists.h>
+#include <UHH2/common/include/JetCorrections.h>
 
 #include <UHH2/ZprimeSemiLeptonic/include/ZprimeSemiLeptonicSelections.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeSemiLeptonicUtils.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeEventView.h>
 #include <UHH2/ZprimeSemiLeptonic/include/ZprimePostSelectionHists.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeSystematics.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeReplicaHists.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeFlatNtuple.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeTTbarReconstruction.h>
 
 /** \brief module to produce "PostSelection" output for the Z'->ttbar semileptonic analysis
+ *
+ * -- systematic variations (XML key "systematics", see ZprimeVariationEngine) evaluated in the same pass as the nominal:
+ *    the t0b0/t0b1/t1 hists are filled for every variation (directories "<category>__<variation>"),
+ *    with the b-tag category and the hist variables re-evaluated in the varied event;
+ *    variations changing the jets/topjets (jec, jer, jets, topjets): varied collections re-thresholded as in the Selection
+ *    (jets pt>30 GeV |eta|<2.4, topjets pt>400 GeV |eta|<2.4), jet cuts of the Selection (jet2, jet1) re-applied,
+ *    t-tag category and ttbar reconstruction (ZprimeTTbarReconstruction, "ttbar_reco__mode" as in the Selection) re-run
+ *    on the varied event, followed by the leptonic-top pt and chi2 cuts and the "<category>__hyp_chi2min__<variation>" hists;
+ *    not varied: MET, the lepton-jet cuts of the Selection (lepton-2Dcut, triangular cuts: jets below 30 GeV not stored),
+ *    and events/jets removed by the nominal Selection can not migrate in;
+ *    variations changing the event weight alone use the nominal hypotheses (cuts passed before the variation loop)
+ *    (weight variations read float branches "weight=<branch>" holding the ratio of the varied to the nominal event weight,
+ *     written to the Selection ntuple by ZprimeSelectionModule with the XML key "weight_ratios": pileup and b-tag up/down)
+ *
+ * -- weight replicas (XML key "replicas" = "bootstrap:N" or "systweights:N[:first]", see ReplicaWeightsProducer):
+ *    replica hists of the t0b0/t0b1/t1 categories in directories "<category>__replicas"
+ *
+ * -- flat input (XML key "flat_input" = "true"): collections and ttbar hypotheses read from the columns of the
+ *    ZprimeSelectionModule flat output (see FlatNtupleReader); the collection names of the XML file must be left empty,
+ *    and "flat__precision"/"flat__discriminators" set as in the Selection job;
+ *    not combined with the variations changing the jets/topjets (flat jets carry no raw JEC factor, no genjets in the flat output,
+ *    flat topjets carry no substructure for the t-tagging of the varied event)
  *
  * -- ITEMS TO BE IMPLEMENTED:
- *   * systematic uncertainties
+ *   * propagation of the JEC/JER variations to MET
  *
  */
 class ZprimePostSelectionModule : public uhh2::AnalysisModule {
@@ -38,6 +70,17 @@ class ZprimePostSelectionModule : public uhh2::AnalysisModule {
 
   uhh2::Event::Handle<int> h_flag_toptagevent;
 
+  // flat input ntuple
+  std::unique_ptr<uhh2::AnalysisModule> flat_reader;
+
+  std::unique_ptr<uhh2::AnalysisModule> lepsum_producer;
+  std::unique_ptr<uhh2::AnalysisModule> view_producer;
+  std::unique_ptr<uhh2::AnalysisModule> vars_producer;
+  std::unique_ptr<uhh2::AnalysisModule> besthyp_producer;
+
+  // discriminators of the best ttbar hypothesis in integer slots (registered by the cuts at construction)
+  std::shared_ptr<DiscriminatorSlots> disc_slots;
+
   // selections
   std::unique_ptr<uhh2::Selection> btagAK4_sel;
   std::unique_ptr<uhh2::Selection> topleppt_sel;
@@ -56,6 +99,33 @@ class ZprimePostSelectionModule : public uhh2::AnalysisModule {
   std::unique_ptr<uhh2::Hists> hi_t0b1__hyp;
   std::unique_ptr<uhh2::Hists> hi_t1;
   std::unique_ptr<uhh2::Hists> hi_t1__hyp;
+
+  // systematic variations
+  std::unique_ptr<ZprimeVariationEngine> systematics;
+
+  // ttbar reconstruction of the variations changing the jets/topjets (hypotheses in a separate handle)
+  std::unique_ptr<uhh2::AnalysisModule> reco_primlep;
+  std::unique_ptr<uhh2::Selection> jet_sel__syst;
+  std::unique_ptr<uhh2::Selection> toptagevt_sel__syst;
+  std::unique_ptr<ZprimeTTbarReconstruction> ttbar_reco__syst;
+  std::shared_ptr<DiscriminatorSlots> disc_slots__syst;
+  uhh2::Event::Handle<BestHypothesis> h_besthyp__syst;
+  std::unique_ptr<uhh2::Selection> topleppt_sel__syst;
+  std::unique_ptr<uhh2::Selection> chi2_sel__syst;
+
+  std::vector<std::unique_ptr<uhh2::Hists>> hi_t0b0__syst;
+  std::vector<std::unique_ptr<uhh2::Hists>> hi_t0b0__hyp__syst;
+  std::vector<std::unique_ptr<uhh2::Hists>> hi_t0b1__syst;
+  std::vector<std::unique_ptr<uhh2::Hists>> hi_t0b1__hyp__syst;
+  std::vector<std::unique_ptr<uhh2::Hists>> hi_t1__syst;
+  std::vector<std::unique_ptr<uhh2::Hists>> hi_t1__hyp__syst;
+
+  // weight replicas (PDF, scale, bootstrap)
+  std::unique_ptr<uhh2::AnalysisModule> replicas_producer;
+
+  std::unique_ptr<uhh2::Hists> hi_t0b0__replicas;
+  std::unique_ptr<uhh2::Hists> hi_t0b1__replicas;
+  std::unique_ptr<uhh2::Hists> hi_t1__replicas;
 };
 
 ZprimePostSelectionModule::ZprimePostSelectionModule(uhh2::Context& ctx){
@@ -75,7 +145,21 @@ ZprimePostSelectionModule::ZprimePostSelectionModule(uhh2::Context& ctx){
   h_ttbargen = ctx.get_handle<TTbarGen>(ttbar_gen_label);
 
   /* RECO */
-  h_ttbar_hyps = ctx.declare_event_input<std::vector<ReconstructionHypothesis>>(ttbar_hyps_label);
+  const std::string& flat_input = ctx.get("flat_input", "false");
+  if(flat_input == "true"){
+
+    const FlatPrecision flat_precision(ctx.get("flat__precision", ""));
+    const std::vector<std::string> flat_discriminators = uhh2::split(ctx.get("flat__discriminators", "Chi2,Chi2_tlep,Chi2_thad"), ",");
+
+    flat_reader.reset(new FlatNtupleReader(ctx, ttbar_hyps_label, flat_precision, flat_discriminators));
+    h_ttbar_hyps = ctx.get_handle<std::vector<ReconstructionHypothesis>>(ttbar_hyps_label);
+  }
+  else if(flat_input == "false") h_ttbar_hyps = ctx.declare_event_input<std::vector<ReconstructionHypothesis>>(ttbar_hyps_label);
+  else throw std::runtime_error("ZprimePostSelectionModule -- undefined argument for 'flat_input' key in xml file (must be 'true' or 'false'): "+flat_input);
+
+  // chi2-best hypothesis and its discriminators, looked up once per event and read by the hypothesis cuts
+  disc_slots.reset(new DiscriminatorSlots);
+  besthyp_producer.reset(new BestHypothesisProducer(ctx, ttbar_hyps_label, ttbar_chi2_label, disc_slots));
   //
 
   // b-tagging
@@ -84,11 +168,18 @@ ZprimePostSelectionModule::ZprimePostSelectionModule(uhh2::Context& ctx){
   // top-tagging flag (from ZprimeSelection ntuple)
   h_flag_toptagevent = ctx.declare_event_input<int>("flag_toptagevent");
 
+  // lepton summary (leading lepton, HTlep) shared by the hists
+  lepsum_producer.reset(new LeptonSummaryProducer(ctx));
+
+  // SoA view and hist variables, computed once per event for all the hist stages
+  view_producer.reset(new ZprimeEventViewProducer(ctx));
+  vars_producer.reset(new ZprimeEventVarsProducer(ctx));
+
   // SELECTION
   if     (channel_ == elec) topleppt_sel.reset(new LeptonicTopPtCut(ctx, 140., uhh2::infinity, ttbar_hyps_label, ttbar_chi2_label));
   else if(channel_ == muon) topleppt_sel.reset(new uhh2::AndSelection(ctx));
 
-  chi2_sel.reset(new HypothesisDiscriminatorCut(ctx, 0., 50., ttbar_hyps_label, ttbar_chi2_label));
+  chi2_sel.reset(new HypothesisDiscriminatorCut(ctx, 0., 50., ttbar_hyps_label, *disc_slots, ttbar_chi2_label, ttbar_chi2_label));
 
   // HISTS
   hi_input.reset(new ZprimePostSelectionHists(ctx, "input"));
@@ -108,10 +199,105 @@ ZprimePostSelectionModule::ZprimePostSelectionModule(uhh2::Context& ctx){
 
   hi_t1.reset(new ZprimePostSelectionHists(ctx, "t1"));
   hi_t1__hyp.reset(new HypothesisHists    (ctx, "t1__hyp_chi2min", ttbar_hyps_label, ttbar_chi2_label));
+
+  // SYSTEMATICS
+  // JEC files of the Selection (JEC variations re-run the correctors with the uncertainty applied)
+  std::vector<std::string> JEC_AK4, JEC_AK8;
+  if(ctx.get("dataset_type") == "MC"){
+
+    JEC_AK4 = JERFiles::Summer15_50ns_L123_AK4PFchs_MC;
+    JEC_AK8 = JERFiles::Summer15_50ns_L123_AK8PFchs_MC;
+  }
+  else {
+
+    JEC_AK4 = JERFiles::Summer15_50ns_L123_AK4PFchs_DATA;
+    JEC_AK8 = JERFiles::Summer15_50ns_L123_AK8PFchs_DATA;
+  }
+
+  // varied collections re-thresholded with the cleaning of the Selection (jet_cleaner2, topjet_cleaner)
+  systematics.reset(new ZprimeVariationEngine(ctx, "systematics", JEC_AK4, JEC_AK8, std::make_pair(30.f, 2.4f), std::make_pair(400.f, 2.4f)));
+
+  bool reco_syst(false);
+  for(size_t i=0; i<systematics->size(); ++i){
+
+    const ZprimeVariation& var = systematics->variation(i);
+    if(var.changes_jets() || var.changes_topjets()) reco_syst = true;
+  }
+
+  const std::string ttbar_hyps_label__syst(ttbar_hyps_label+"__syst");
+  if(reco_syst){
+
+    // same jet cuts, t-tagging and ttbar reconstruction as ZprimeSelectionModule
+    uhh2::AndSelection* jet_sel = new uhh2::AndSelection(ctx);
+    jet_sel->add<NJetSelection>("jet2", 2, -1, JetId(PtEtaCut( 50., 2.4)));
+    jet_sel->add<NJetSelection>("jet1", 1, -1, JetId(PtEtaCut(200., 2.4)));
+    jet_sel__syst.reset(jet_sel);
+
+    const TopJetId topjetID = AndId<TopJet>(CMSTopTag(CMSTopTag::MassType::groomed), Tau32());
+    const float minDR_topjet_jet(1.2);
+
+    reco_primlep.reset(new PrimaryLepton(ctx));
+    toptagevt_sel__syst.reset(new TopTagEventSelection(topjetID, minDR_topjet_jet));
+
+    // best hypothesis and chi2 slots of the varied event computed by the reconstruction
+    disc_slots__syst.reset(new DiscriminatorSlots);
+    ttbar_reco__syst.reset(new ZprimeTTbarReconstruction(ctx, ttbar_hyps_label__syst, ttbar_chi2_label, topjetID, minDR_topjet_jet, disc_slots__syst));
+    h_besthyp__syst = ctx.get_handle<BestHypothesis>(best_hypothesis_label(ttbar_hyps_label__syst, ttbar_chi2_label));
+
+    if     (channel_ == elec) topleppt_sel__syst.reset(new LeptonicTopPtCut(ctx, 140., uhh2::infinity, ttbar_hyps_label__syst, ttbar_chi2_label));
+    else if(channel_ == muon) topleppt_sel__syst.reset(new uhh2::AndSelection(ctx));
+
+    chi2_sel__syst.reset(new HypothesisDiscriminatorCut(ctx, 0., 50., ttbar_hyps_label__syst, *disc_slots__syst, ttbar_chi2_label, ttbar_chi2_label));
+  }
+
+  for(size_t i=0; i<systematics->size(); ++i){
+
+    const ZprimeVariation& var = systematics->variation(i);
+
+    if(flat_reader && (var.changes_jets() || var.changes_topjets()))
+      throw std::runtime_error("ZprimePostSelectionModule -- jet/topjet variation '"+var.name+"' not supported with 'flat_input' (flat jets w/o raw JEC factor, no genjets, flat topjets w/o substructure for the t-tagging)");
+
+    // hypotheses re-computed on the varied jets/topjets, nominal ones for the weight variations
+    const std::string& hyps = (var.changes_jets() || var.changes_topjets()) ? ttbar_hyps_label__syst : ttbar_hyps_label;
+
+    hi_t0b0__syst     .emplace_back(new ZprimePostSelectionHists(ctx, "t0b0__"+var.name));
+    hi_t0b0__hyp__syst.emplace_back(new HypothesisHists         (ctx, "t0b0__hyp_chi2min__"+var.name, hyps, ttbar_chi2_label));
+
+    hi_t0b1__syst     .emplace_back(new ZprimePostSelectionHists(ctx, "t0b1__"+var.name));
+    hi_t0b1__hyp__syst.emplace_back(new HypothesisHists         (ctx, "t0b1__hyp_chi2min__"+var.name, hyps, ttbar_chi2_label));
+
+    hi_t1__syst       .emplace_back(new ZprimePostSelectionHists(ctx, "t1__"+var.name));
+    hi_t1__hyp__syst  .emplace_back(new HypothesisHists         (ctx, "t1__hyp_chi2min__"+var.name, hyps, ttbar_chi2_label));
+  }
+
+  // REPLICAS
+  const std::string& replicas = ctx.get("replicas", "");
+  if(replicas != ""){
+
+    const auto fields = uhh2::split(replicas, ":");
+    if(fields.size() != 2 && fields.size() != 3) throw std::runtime_error("ZprimePostSelectionModule -- invalid argument for 'replicas' key in xml file (must be 'mode:N[:first]'): "+replicas);
+
+    const int nreplicas = std::stoi(fields.at(1));
+    const int first     = fields.size() == 3 ? std::stoi(fields.at(2)) : 0;
+
+    replicas_producer.reset(new ReplicaWeightsProducer(ctx, "ReplicaWeights", fields.at(0), nreplicas, first));
+
+    hi_t0b0__replicas.reset(new ZprimeReplicaHists(ctx, "t0b0__replicas", "ReplicaWeights", nreplicas, false, ttbar_hyps_label, ttbar_chi2_label));
+    hi_t0b1__replicas.reset(new ZprimeReplicaHists(ctx, "t0b1__replicas", "ReplicaWeights", nreplicas, false, ttbar_hyps_label, ttbar_chi2_label));
+    hi_t1__replicas  .reset(new ZprimeReplicaHists(ctx, "t1__replicas"  , "ReplicaWeights", nreplicas, false, ttbar_hyps_label, ttbar_chi2_label));
+  }
 }
 
 bool ZprimePostSelectionModule::process(uhh2::Event& event){
 
+  if(flat_reader) flat_reader->process(event);
+
+  lepsum_producer->process(event);
+  view_producer  ->process(event);
+  vars_producer  ->process(event);
+
+  besthyp_producer->process(event);
+
   hi_input->fill(event);
   hi_input__hyp->fill(event);
 
@@ -132,25 +318,78 @@ bool ZprimePostSelectionModule::process(uhh2::Event& event){
   const bool btag(btagAK4_sel->passes(event));
   const bool toptag(event.get(h_flag_toptagevent));
 
+  if(replicas_producer) replicas_producer->process(event);
+
   if(!toptag){
 
     if(!btag){
 
       hi_t0b0->fill(event);
       hi_t0b0__hyp->fill(event);
+      if(hi_t0b0__replicas) hi_t0b0__replicas->fill(event);
     }
     else {
 
       hi_t0b1->fill(event);
       hi_t0b1__hyp->fill(event);
+      if(hi_t0b1__replicas) hi_t0b1__replicas->fill(event);
     }
   }
   else {
 
     hi_t1->fill(event);
     hi_t1__hyp->fill(event);
+    if(hi_t1__replicas) hi_t1__replicas->fill(event);
   }
 
+  //// SYSTEMATIC VARIATIONS (jets/topjets varied in place and event weight rescaled, nominal restored on scope exit)
+  if(reco_primlep) reco_primlep->process(event);
+
+  for(size_t i=0; i<systematics->size(); ++i){
+
+    ZprimeVariationScope var(*systematics, event, i);
+
+    const ZprimeVariation& v = systematics->variation(i);
+
+    // jets/topjets varied: Selection jet cuts, t-tag category, ttbar reconstruction and hypothesis cuts re-evaluated
+    bool toptag_var(toptag);
+    if(v.changes_jets() || v.changes_topjets()){
+
+      if(!jet_sel__syst->passes(event)) continue;
+
+      toptag_var = toptagevt_sel__syst->passes(event);
+
+      ttbar_reco__syst->process(event, toptag_var);
+      if(!event.get(h_besthyp__syst).hyp) continue;
+
+      if(!topleppt_sel__syst->passes(event)) continue;
+      if(!chi2_sel__syst    ->passes(event)) continue;
+    }
+
+    view_producer->process(event);
+    vars_producer->process(event);
+
+    if(!toptag_var){
+
+      if(!btagAK4_sel->passes(event)){
+
+        hi_t0b0__syst     .at(i)->fill(event);
+        hi_t0b0__hyp__syst.at(i)->fill(event);
+      }
+      else {
+
+        hi_t0b1__syst     .at(i)->fill(event);
+        hi_t0b1__hyp__syst.at(i)->fill(event);
+      }
+    }
+    else {
+
+      hi_t1__syst     .at(i)->fill(event);
+      hi_t1__hyp__syst.at(i)->fill(event);
+    }
+  }
+  ////
+
   return false;
 }
 
@@ -23,6 +23,8 @@
 
 /** \brief module to produce "PreSelection" ntuples for the Z'->ttbar semileptonic analysis
  *  NOTE: output ntuple contains uncleaned jets (no jet-lepton cleaning, no JER smearing)
+ *        [jet corrections/cleaning of the jet pre-selection: jets in a module-owned scratch copy (ScopedCollectionSwap),
+ *         topjets corrected in place and restored (ScopedJetStates), topjet cleaning as a pass mask]
  */
 class ZprimePreSelectionModule : public uhh2::AnalysisModule {
 
@@ -42,15 +44,18 @@ class ZprimePreSelectionModule : public uhh2::AnalysisModule {
   std::unique_ptr<JetCleaner>       jet_cleaner;
 
   std::unique_ptr<TopJetCorrector>           topjet_corrector;
-  std::unique_ptr<TopJetLeptonDeltaRCleaner> topjetlepton_cleaner;
-  std::unique_ptr<TopJetCleaner>             topjet_cleaner;
+  std::unique_ptr<TopJetLeptonDeltaRCleaner> topjetlepton_cleaner; // overlap flags only (topjets not erased)
+  TopJetId topjet_id;
+
+  // scratch storage of the corrected/cleaned jets, (v4, JEC_factor_raw) of the topjets (input collections stored uncleaned in the ntuple)
+  std::vector<Jet>      jets_scratch;
+  std::vector<JetState> topjet_states;
 
   // selections
   std::unique_ptr<uhh2::Selection> muo1_sel;
   std::unique_ptr<uhh2::Selection> ele1_sel;
   std::unique_ptr<uhh2::Selection> jet1_sel;
   std::unique_ptr<uhh2::Selection> jet2_sel;
-  std::unique_ptr<uhh2::Selection> topjet1_sel;
 
   // histograms
   std::unique_ptr<uhh2::Hists> input_h_event;
@@ -97,7 +102,7 @@ ZprimePreSelectionModule::ZprimePreSelectionModule(uhh2::Context& ctx){
 
   topjet_corrector.reset(new TopJetCorrector(ctx, JEC_AK8));
   topjetlepton_cleaner.reset(new TopJetLeptonDeltaRCleaner(.8));
-  topjet_cleaner.reset(new TopJetCleaner(TopJetId(PtEtaCut(200., 2.4))));
+  topjet_id = TopJetId(PtEtaCut(200., 2.4));
 
   // set up selections
   muo1_sel.reset(new NMuonSelection(1));      // at least 1 muon
@@ -106,8 +111,6 @@ ZprimePreSelectionModule::ZprimePreSelectionModule(uhh2::Context& ctx){
   jet1_sel.reset(new NJetSelection(1));       // at least 1 jet
   jet2_sel.reset(new NJetSelection(2));       // at least 2 jets
 
-  topjet1_sel.reset(new NTopJetSelection(1)); // at least 1 topjet
-
   // set up histograms
   input_h_event .reset(new EventHists   (ctx, "input_Event"));
   input_h_muo   .reset(new MuonHists    (ctx, "input_Muons"));
@@ -145,34 +148,37 @@ bool ZprimePreSelectionModule::process(Event & event) {
   // exit if lepton selection fails, otherwise proceed to jet selection
   if(!pass_lep) return false;
 
-  // keep Jets *before cleaning* to store them in the ntuple if event is accepted
-  std::unique_ptr< std::vector<Jet> >    uncleaned_jets   (new std::vector<Jet>   (*event.jets));
-  std::unique_ptr< std::vector<TopJet> > uncleaned_topjets(new std::vector<TopJet>(*event.topjets));
+  // JET CLEANING + JET PRE-SELECTION [input jets *before cleaning* stored in the ntuple]
+  // jets: corrected/cleaned scratch copy (JetLeptonCleaner also changes the lepton energy fractions of the jets);
+  // topjets: corrected in place and restored, cleaning as a pass mask (no copy of the topjets and their subjets)
+  bool pass_jet(false);
+  {
+    assert(event.topjets);
+
+    ScopedCollectionSwap<Jet> jets_scope   (event, &uhh2::Event::jets, jets_scratch);
+    ScopedJetStates<TopJet>   topjets_scope(*event.topjets, topjet_states);
+
+    jet_corrector->process(event);
+    jetlepton_cleaner->process(event);
+    jet_cleaner->process(event);
 
-  // JET CLEANING
-  jet_corrector->process(event);
-  jetlepton_cleaner->process(event);
-  jet_cleaner->process(event);
+    topjet_corrector->process(event);
 
-  topjet_corrector->process(event);
-  topjetlepton_cleaner->process(event);
-  topjet_cleaner->process(event);
+    bool pass_topjet1(false);
+    const std::vector<char>& topjet_overlaps = topjetlepton_cleaner->overlaps(event);
+    for(size_t i=0; i<event.topjets->size(); ++i){
 
-  // JET PRE-SELECTION
-  const bool pass_jet = jet2_sel->passes(event) || (jet1_sel->passes(event) && topjet1_sel->passes(event));
+      if(!topjet_overlaps[i] && topjet_id(event.topjets->at(i), event)){ pass_topjet1 = true; break; }
+    }
+
+    pass_jet = jet2_sel->passes(event) || (jet1_sel->passes(event) && pass_topjet1);
+  }
 
   // exit if jet preselection fails
   if(!pass_jet) return false;
 
-  // store Jets *before cleaning* in the ntuple
-  event.jets->clear();
-  event.jets->reserve(uncleaned_jets->size());
-  for(const auto & j : *uncleaned_jets) event.jets->push_back(j); 
-  sort_by_pt<Jet>(*event.jets);
-
-  event.topjets->clear();
-  event.topjets->reserve(uncleaned_topjets->size());
-  for(const auto & j : *uncleaned_topjets) event.topjets->push_back(j); 
+  // store Jets *before cleaning* in the ntuple (pt-ordered in place)
+  sort_by_pt<Jet>   (*event.jets);
   sort_by_pt<TopJet>(*event.topjets);
 
   // dump output content
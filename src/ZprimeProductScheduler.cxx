@@ -0,0 +1,78 @@
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeProductScheduler.h>
+
+#include <chrono>
+#include <stdexcept>
+
+void ProductScheduler::add(const std::string& name, const Producer& producer, const std::vector<std::string>& deps){
+
+  for(const auto& p : products_){
+    if(p.name == name) throw std::runtime_error("ProductScheduler::add -- product already defined: "+name);
+  }
+
+  if(!producer) throw std::runtime_error("ProductScheduler::add -- null producer for product: "+name);
+
+  Product prod;
+  prod.name     = name;
+  prod.producer = producer;
+  prod.done     = false;
+  prod.time     = 0.;
+
+  for(const auto& d : deps) prod.deps.push_back(id(d));
+
+  products_.push_back(prod);
+
+  return;
+}
+
+size_t ProductScheduler::id(const std::string& name) const {
+
+  for(size_t i=0; i<products_.size(); ++i){
+    if(products_[i].name == name) return i;
+  }
+
+  throw std::runtime_error("ProductScheduler::id -- product not defined (dependencies must be added before the products using them): "+name);
+}
+
+void ProductScheduler::require(uhh2::Event& event, const size_t i){
+
+  Product& prod = products_.at(i);
+  if(prod.done) return;
+
+  for(const auto d : prod.deps) require(event, d);
+
+  if(timing_ > 0){
+
+    const auto t0 = std::chrono::steady_clock::now();
+    prod.producer(event);
+    const auto t1 = std::chrono::steady_clock::now();
+
+    prod.time = std::chrono::duration<double>(t1-t0).count();
+  }
+  else prod.producer(event);
+
+  prod.done = true;
+
+  return;
+}
+
+std::vector<char> ProductScheduler::closure(const std::vector<size_t>& ids) const {
+
+  std::vector<char> flags(products_.size(), 0);
+
+  // dependencies always have lower ids: one backward sweep
+  for(const auto i : ids) flags.at(i) = 1;
+  for(size_t i=products_.size(); i-- > 0;){
+
+    if(!flags[i]) continue;
+    for(const auto d : products_[i].deps) flags[d] = 1;
+  }
+
+  return flags;
+}
+
+void ProductScheduler::reset(){
+
+  for(auto& p : products_){ p.done = false; p.time = 0.; }
+
+  return;
+}
@@ -0,0 +1,182 @@
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeReplicaHists.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+
+#include <TH1D.h>
+#include <TH2D.h>
+
+#include <UHH2/common/include/ReconstructionHypothesisDiscriminators.h>
+
+namespace {
+
+  /* splitmix64: stateless mixing of the event/replica identifiers into a uniform random number */
+  uint64_t mix64(uint64_t x){
+
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  /* Poisson(1) by inversion of the CDF */
+  int poisson1(const double u){
+
+    int k(0);
+    double p(std::exp(-1.)), cdf(p);
+    while(u > cdf && k < 20){ ++k; p /= k; cdf += p; }
+
+    return k;
+  }
+}
+
+ReplicaWeightsProducer::ReplicaWeightsProducer(uhh2::Context& ctx, const std::string& label, const std::string& mode, const int nreplicas, const int first):
+  nreplicas_(nreplicas), first_(first) {
+
+  if     (mode == "bootstrap")   mode_ = bootstrap;
+  else if(mode == "systweights") mode_ = systweights;
+  else throw std::runtime_error("ReplicaWeightsProducer::ReplicaWeightsProducer -- undefined mode (must be 'bootstrap' or 'systweights'): "+mode);
+
+  if(nreplicas_ <= 0 || first_ < 0) throw std::runtime_error("ReplicaWeightsProducer::ReplicaWeightsProducer -- invalid number of replicas or first index");
+
+  h_weights_ = ctx.get_handle<ReplicaWeights>(label);
+
+  weights_.w.resize(nreplicas_);
+}
+
+bool ReplicaWeightsProducer::process(uhh2::Event& event){
+
+  if(mode_ == bootstrap){
+
+    const uint64_t seed = mix64(mix64(mix64(uint64_t(event.run)) ^ uint64_t(event.luminosityBlock)) ^ uint64_t(event.event));
+
+    for(int r=0; r<nreplicas_; ++r){
+
+      const double u = (mix64(seed ^ uint64_t(r)) >> 11) * (1./9007199254740992.); // 53-bit uniform in [0, 1)
+      weights_.w[r] = event.weight * poisson1(u);
+    }
+  }
+  else if(mode_ == systweights){
+
+    assert(event.genInfo);
+
+    const std::vector<float>& sw = event.genInfo->systweights();
+    if(int(sw.size()) < first_+nreplicas_) throw std::runtime_error("ReplicaWeightsProducer::process -- not enough generator weights in GenInfo::systweights()");
+
+    const double w0 = event.genInfo->originalXWGTUP();
+    for(int r=0; r<nreplicas_; ++r) weights_.w[r] = w0 ? event.weight * sw[first_+r] / w0 : 0.;
+  }
+
+  event.set(h_weights_, weights_);
+
+  return true;
+}
+////////////////////////////////////////////////////////
+
+ReplicaHist::ReplicaHist(const std::vector<TH1*>& targets, const int nx, const double xmin, const double xmax, const int nreplicas):
+  targets_(targets), nx_(nx), xmin_(xmin), xmax_(xmax), nrep_(nreplicas) {
+
+  if(targets_.size() != 1 && int(targets_.size()) != nrep_) throw std::runtime_error("ReplicaHist::ReplicaHist -- number of targets must be 1 (2D output) or the number of replicas");
+
+  output_2d_ = (targets_.size() == 1);
+  entries_step_ = output_2d_ ? nrep_ : 1.;
+
+  for(auto* t : targets_){
+
+    TArrayD* content = dynamic_cast<TArrayD*>(t);
+    if(!content) throw std::runtime_error("ReplicaHist::ReplicaHist -- target histogram must be a TH1D or TH2D: "+std::string(t->GetName()));
+
+    if(!t->GetSumw2N()) t->Sumw2();
+
+    sumw_ .push_back(content->GetArray());
+    sumw2_.push_back(t->GetSumw2()->GetArray());
+  }
+}
+////////////////////////////////////////////////////////
+
+ZprimeReplicaHists::ZprimeReplicaHists(uhh2::Context& ctx, const std::string& dirname, const std::string& weights, const int nreplicas, const bool lep2,
+                                       const std::string& hyps, const std::string& discriminator, const std::string& view, const std::string& lepsum):
+  uhh2::Hists(ctx, dirname), discriminator_(discriminator), nreplicas_(nreplicas) {
+
+  h_weights_ = ctx.get_handle<ReplicaWeights>(weights);
+  h_view_    = ctx.get_handle<ZprimeEventView>(view);
+  h_lepsum_  = ctx.get_handle<LeptonSummary>(lepsum);
+  h_vars_    = ctx.get_handle<ZprimeEventVars>(view+"__vars");
+  h_hyps_    = ctx.get_handle<std::vector<ReconstructionHypothesis>>(hyps);
+  h_best_    = ctx.get_handle<BestHypothesis>(best_hypothesis_label(hyps, discriminator));
+
+  const std::string& output = ctx.get("replicas__output", "2d");
+  if     (output == "2d") output_2d_ = true;
+  else if(output == "1d") output_2d_ = false;
+  else throw std::runtime_error("ZprimeReplicaHists::ZprimeReplicaHists -- undefined argument for 'replicas__output' key in xml file (must be '2d' or '1d'): "+output);
+
+  // 1D weighted histograms of the Zprime hist set
+  for(const auto& d : zprime_hists){
+
+    if((d.lep2 && !lep2) || d.nbinsy || !d.weighted) hists_.emplace_back();
+    else hists_.push_back(book_replicas(d.name, d.title, d.nbinsx, d.xmin, d.xmax));
+  }
+
+  // best ttbar hypothesis
+  hyp_M_ttbar_       = book_replicas("M_ttbar_rec"  , ";M_{t#bar{t}}^{rec} [GeV]", 120, 0, 6000);
+  hyp_discriminator_ = book_replicas("discriminator", ";discriminator"           , 100, 0,  500);
+}
+
+std::unique_ptr<ReplicaHist> ZprimeReplicaHists::book_replicas(const std::string& name, const std::string& title, const int nx, const double xmin, const double xmax){
+
+  std::vector<TH1*> targets;
+
+  if(output_2d_) targets.push_back(book<TH2D>(name, (";replica"+title).c_str(), nreplicas_, 0, nreplicas_, nx, xmin, xmax));
+  else {
+
+    for(int r=0; r<nreplicas_; ++r){
+
+      char suffix[16];
+      std::snprintf(suffix, sizeof(suffix), "__rep%03d", r);
+      targets.push_back(book<TH1D>(name+suffix, title.c_str(), nx, xmin, xmax));
+    }
+  }
+
+  return std::unique_ptr<ReplicaHist>(new ReplicaHist(targets, nx, xmin, xmax, nreplicas_));
+}
+
+void ZprimeReplicaHists::fill(const uhh2::Event& event){
+
+  const ReplicaWeights& weights = event.get(h_weights_);
+  if(int(weights.w.size()) != nreplicas_) throw std::runtime_error("ZprimeReplicaHists::fill -- number of replica weights different from the number of booked replicas");
+
+  const double* w = weights.w.data();
+
+  // variables: shared event record if computed from the current view content, local record otherwise
+  const ZprimeEventView* view(0);
+  if(event.is_valid(h_view_)) view = &event.get(h_view_);
+  else { view_.fill(event); view = &view_; }
+
+  const ZprimeEventVars* vars(0);
+  if(view->id && event.is_valid(h_vars_) && event.get(h_vars_).view_id == view->id) vars = &event.get(h_vars_);
+  else {
+
+    vars_.fill(event, *view, event.is_valid(h_lepsum_) ? &event.get(h_lepsum_) : 0);
+    vars = &vars_;
+  }
+
+  for(size_t i=0; i<hists_.size(); ++i){
+
+    if(!hists_[i]) continue;
+
+    const ZprimeHistDescriptor& d = zprime_hists[i];
+    if(vars->set[d.varx]) hists_[i]->fill(vars->val[d.varx], w);
+  }
+
+  // best ttbar hypothesis
+  const ReconstructionHypothesis* hyp = get_best_hypothesis(event, h_hyps_, h_best_, discriminator_);
+  if(hyp){
+
+    hyp_M_ttbar_      ->fill((hyp->toplep_v4()+hyp->tophad_v4()).M(), w);
+    hyp_discriminator_->fill(hyp->discriminator(discriminator_), w);
+  }
+
+  return;
+}
@@ -1,15 +1,16 @@
 #include <iostream>
 #include <memory>
+#include <utility>
 
 #include <UHH2/core/include/AnalysisModule.h>
 #include <UHH2/core/include/Event.h>
 #include <UHH2/core/include/Selection.h>
+#include <UHH2/core/include/Utils.h>
 
 #include <UHH2/common/include/MCWeight.h>
 #include <UHH2/common/include/CleaningModules.h>
 #include <UHH2/common/include/NSelections.h>
 #include <UHH2/common/include/LumiSelection.h>
-#include <UHH2/common/include/TriggerSelection.h>
 #include <UHH2/common/include/JetCorrections.h>
 #include <UHH2/common/include/ObjectIdUtils.h>
 #include <UHH2/common/include/MuonIds.h>
@@ -25,7 +26,12 @@
 
 #include <UHH2/ZprimeSemiLeptonic/include/ZprimeSemiLeptonicSelections.h>
 #include <UHH2/ZprimeSemiLeptonic/include/ZprimeSemiLeptonicUtils.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeEventView.h>
 #include <UHH2/ZprimeSemiLeptonic/include/ZprimeSelectionHists.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeCutflow.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeProductScheduler.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeTTbarReconstruction.h>
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeFlatNtuple.h>
 
 /** \brief module to produce "Selection" ntuples for the Z'->ttbar semileptonic analysis
  *
@@ -41,6 +47,24 @@
  *     * lepton-2D-cut [DR>0.4 || pTrel>25 GeV] (wrt AK4 jets w/ pt>25 GeV)
  *     * (electron-only) triangular cuts
  *   * perform ttbar kinematical reconstruction (hyps stored in output ntuple)
+ *     (xml key "ttbar_reco__mode": "exhaustive" enumeration, "stream" scoring of the hypotheses while generated
+ *      keeping the "ttbar_reco__top_k" best ones, or "bnb" branch-and-bound search of the best ones;
+ *      "ttbar_reco__max_jets" leading jets considered)
+ *   * optional flat output (xml key "flat_output"): quantized columns read by ZprimePostSelectionModule (see FlatNtupleWriter)
+ *     in place of the full uhh2 collections and hypotheses (per-column precision via "flat__precision")
+ *   * cutflow steps run by Cutflow objects "cutflow__lep" and "cutflow__jet"
+ *     (step order configurable via xml keys "cutflow__lep__steps" and "cutflow__jet__steps",
+ *      adaptive ordering of the jet block via "cutflow__jet__adaptive")
+ *   * optional ratios of the varied to the nominal event weight (xml key "weight_ratios" = "pileup" and/or "btag", MC only),
+ *     read by the "weight=<branch>" variations of ZprimePostSelectionModule: float branches
+ *     "weight_ratio__pu_up"/"weight_ratio__pu_dn" (MCPileupReweight up/down, "pileup_directory_data_up"/"_down")
+ *     and "weight_ratio__btag_up"/"weight_ratio__btag_dn" (MCBTagScaleFactor up/down of the CSV medium AK4 b-tag, "MCBtagEfficiencies")
+ *   * object reconstruction run lazily (ProductScheduler): each cutflow step requests the products
+ *     it needs, so JEC and jet/topjet cleaning run only for events passing the preceding cuts
+ *     (products: leptons -> jets25, topjets -> view25 -> jets30 -> view, and the hist variables vars25/vars;
+ *      the trigger-stage hists only read lepton/MET variables (viewlep, varslep) unless xml key "cutflow__lep__jet_hists" = "true":
+ *      by default no jet reconstruction before the lepton selection, so events failing it run no JEC or jet/topjet cleaning;
+ *      with the key set, the "trigger" directory keeps the jet/topjet hists and the jets are reconstructed for every event passing the trigger)
  *
  * -- ITEMS TO BE IMPLEMENTED:
  *   * JER smearing for TopJet collection
@@ -75,42 +99,53 @@ class ZprimeSelectionModule : public uhh2::AnalysisModule {
   std::unique_ptr<TopJetLeptonDeltaRCleaner> topjetlepton_cleaner;
   std::unique_ptr<TopJetCleaner>             topjet_cleaner;
 
+  // SoA view of the cleaned collections (jet pt>25 GeV view for the lepton-2Dcut, lepton-only view for the trigger hists)
+  std::unique_ptr<uhh2::AnalysisModule> view_producer;
+  std::unique_ptr<uhh2::AnalysisModule> view25_producer;
+  std::unique_ptr<uhh2::AnalysisModule> viewlep_producer;
+  std::unique_ptr<uhh2::AnalysisModule> vars_producer;   // hist variables shared by the stage hists
+  std::unique_ptr<uhh2::AnalysisModule> vars25_producer;
+  std::unique_ptr<uhh2::AnalysisModule> varslep_producer;
+  std::unique_ptr<uhh2::AnalysisModule> lepsum_producer;
+
+  // lazy object reconstruction
+  ProductScheduler products;
+
   // Data/MC scale factors
   std::unique_ptr<uhh2::AnalysisModule> pileup_SF;
 
+  // varied/nominal weight ratios for the PostSelection weight variations
+  std::vector<std::unique_ptr<uhh2::AnalysisModule>> pileup_ratios;
+  std::vector<std::unique_ptr<uhh2::AnalysisModule>> btag_ratios;
+
   // selections
   std::unique_ptr<uhh2::Selection> lumi_sel;
   std::unique_ptr<uhh2::AndSelection> metfilters_sel;
 
-  std::unique_ptr<uhh2::Selection> trigger_sel;
-  std::unique_ptr<uhh2::AndSelection> lep1_sel;
-  std::unique_ptr<uhh2::Selection> jet2_sel;
-  std::unique_ptr<uhh2::Selection> jet1_sel;
-  std::unique_ptr<uhh2::Selection> met_sel;
-  std::unique_ptr<uhh2::Selection> htlep_sel;
-  std::unique_ptr<uhh2::Selection> twodcut_sel;
-  std::unique_ptr<uhh2::Selection> triangc_sel;
+  // HLT paths and MET filters resolved once per trigger menu
+  std::unique_ptr<TriggerBitIndex> trigger_bits;
+
+  std::unique_ptr<Cutflow> lep_cutflow; // HLT, ==1 lepton
+  std::unique_ptr<Cutflow> jet_cutflow; // jets, MET, HT_lep, lepton-2Dcut, triangular cuts
+
   std::unique_ptr<uhh2::Selection> toptagevt_sel;
 
   // ttbar reconstruction
   std::unique_ptr<uhh2::AnalysisModule> ttgenprod;
   std::unique_ptr<uhh2::Selection> genmttbar_sel;
   std::unique_ptr<uhh2::AnalysisModule> reco_primlep;
-  std::unique_ptr<uhh2::AnalysisModule> ttbar_reco__ttag0, ttbar_reco__ttag1;
-  std::unique_ptr<uhh2::AnalysisModule> ttbar_chi2__ttag0, ttbar_chi2__ttag1;
+  std::unique_ptr<ZprimeTTbarReconstruction> ttbar_reco;
+
+  std::shared_ptr<DiscriminatorSlots> disc_slots;
 
   uhh2::Event::Handle<std::vector<ReconstructionHypothesis>> h_ttbar_hyps;
+  uhh2::Event::Handle<BestHypothesis> h_ttbar_best;
+
+  // flat output ntuple
+  std::unique_ptr<uhh2::AnalysisModule> flat_writer;
 
   // hists
   std::unique_ptr<uhh2::Hists> input_h;
-  std::unique_ptr<uhh2::Hists> trigger_h;
-  std::unique_ptr<uhh2::Hists> lep1_h;
-  std::unique_ptr<uhh2::Hists> jet2_h;
-  std::unique_ptr<uhh2::Hists> jet1_h;
-  std::unique_ptr<uhh2::Hists> met_h;
-  std::unique_ptr<uhh2::Hists> htlep_h;
-  std::unique_ptr<uhh2::Hists> twodcut_h;
-  std::unique_ptr<uhh2::Hists> triangc_h;
   std::unique_ptr<uhh2::Hists> toptagevt_h;
   std::unique_ptr<uhh2::Hists> chi2min_toptag0_h;
   std::unique_ptr<uhh2::Hists> chi2min_toptag1_h;
@@ -130,11 +165,34 @@ ZprimeSelectionModule::ZprimeSelectionModule(uhh2::Context& ctx){
   else     lumi_sel.reset(new LumiSelection(ctx));
 
   /* MET filters */
+  trigger_bits.reset(new TriggerBitIndex(ctx));
+
+  // one cutflow entry per filter (bins of the "metfilters" cutflow histogram)
   metfilters_sel.reset(new uhh2::AndSelection(ctx, "metfilters"));
-  metfilters_sel->add<TriggerSelection>("CSCTightHalo", "Flag_CSCTightHaloFilter");
-  metfilters_sel->add<TriggerSelection>("eeBadSc"     , "Flag_eeBadScFilter");
+  metfilters_sel->add<TriggerBitSelection>("CSCTightHalo", ctx, trigger_bits->add("Flag_CSCTightHaloFilter"));
+  metfilters_sel->add<TriggerBitSelection>("eeBadSc"     , ctx, trigger_bits->add("Flag_eeBadScFilter"));
   metfilters_sel->add<NPVSelection>    ("1-good-vtx"  , 1, -1, PrimaryVertexId(StandardPrimaryVertexId()));
 
+  /* varied/nominal weight ratios */
+  for(const auto& wr : uhh2::split(ctx.get("weight_ratios", ""), ",")){
+
+    if(wr == "" || !isMC) continue;
+
+    if(wr == "pileup"){
+
+      pileup_ratios.emplace_back(new WeightRatioProducer(ctx, "weight_ratio__pu_up", make_unique<MCPileupReweight>(ctx), make_unique<MCPileupReweight>(ctx, "up")));
+      pileup_ratios.emplace_back(new WeightRatioProducer(ctx, "weight_ratio__pu_dn", make_unique<MCPileupReweight>(ctx), make_unique<MCPileupReweight>(ctx, "down")));
+    }
+    else if(wr == "btag"){
+
+      btag_ratios.emplace_back(new WeightRatioProducer(ctx, "weight_ratio__btag_up", make_unique<MCBTagScaleFactor>(ctx, CSVBTag::WP_MEDIUM),
+                                                                                     make_unique<MCBTagScaleFactor>(ctx, CSVBTag::WP_MEDIUM, "jets", "up")));
+      btag_ratios.emplace_back(new WeightRatioProducer(ctx, "weight_ratio__btag_dn", make_unique<MCBTagScaleFactor>(ctx, CSVBTag::WP_MEDIUM),
+                                                                                     make_unique<MCBTagScaleFactor>(ctx, CSVBTag::WP_MEDIUM, "jets", "down")));
+    }
+    else throw std::runtime_error("ZprimeSelectionModule -- undefined argument for 'weight_ratios' key in xml file (must be 'pileup' and/or 'btag'): "+wr);
+  }
+
   //// OBJ CLEANING
   muo_cleaner.reset(new MuonCleaner    (AndId<Muon>    (PtEtaCut  (50., 2.1), MuonIDMedium())));
   ele_cleaner.reset(new ElectronCleaner(AndId<Electron>(PtEtaSCCut(50., 2.5), ElectronID_MVAnotrig_Spring15_25ns_loose)));
@@ -166,40 +224,115 @@ ZprimeSelectionModule::ZprimeSelectionModule(uhh2::Context& ctx){
 //!!  topjetER_smearer.reset(new TopJetResolutionSmearer(ctx));
   topjetlepton_cleaner.reset(new TopJetLeptonDeltaRCleaner(.8));
   topjet_cleaner.reset(new TopJetCleaner(TopJetId(PtEtaCut(400., 2.4))));
+
+  view_producer  .reset(new ZprimeEventViewProducer(ctx));
+  view25_producer.reset(new ZprimeEventViewProducer(ctx, "ZprimeEventView__jet25"));
+  viewlep_producer.reset(new ZprimeEventViewProducer(ctx, "ZprimeEventView__lep", false));
+  vars_producer  .reset(new ZprimeEventVarsProducer(ctx));
+  vars25_producer.reset(new ZprimeEventVarsProducer(ctx, "ZprimeEventView__jet25"));
+  varslep_producer.reset(new ZprimeEventVarsProducer(ctx, "ZprimeEventView__lep"));
+  lepsum_producer.reset(new LeptonSummaryProducer(ctx));
   ////
 
   //// EVENT SELECTION
   const std::string& trigger = ctx.get("trigger", "NULL");
 
-  lep1_sel.reset(new uhh2::AndSelection(ctx));
+  std::unique_ptr<uhh2::Selection> trigger_sel;
+  std::unique_ptr<uhh2::AndSelection> lep1_sel(new uhh2::AndSelection(ctx));
   if(channel_ == muon){
 
     lep1_sel->add<NMuonSelection>    ("muoN == 1", 1, 1);
     lep1_sel->add<NElectronSelection>("eleN == 0", 0, 0);
 
-    if(trigger != "NULL") trigger_sel = make_unique<TriggerSelection>(trigger);
-    else                  trigger_sel = make_unique<TriggerSelection>("HLT_Mu45_eta2p1_v*");
+    if(trigger != "NULL") trigger_sel = make_unique<TriggerBitSelection>(ctx, trigger_bits->add(trigger));
+    else                  trigger_sel = make_unique<TriggerBitSelection>(ctx, trigger_bits->add("HLT_Mu45_eta2p1_v*"));
   }
   else if(channel_ == elec){
 
     lep1_sel->add<NMuonSelection>    ("muoN == 0", 0, 0);
     lep1_sel->add<NElectronSelection>("eleN == 1", 1, 1);
 
-    if(trigger != "NULL") trigger_sel = make_unique<TriggerSelection>(trigger);
-    else                  trigger_sel = make_unique<TriggerSelection>("HLT_Ele45_CaloIdVT_GsfTrkIdT_PFJet200_PFJet50_v*");
+    if(trigger != "NULL") trigger_sel = make_unique<TriggerBitSelection>(ctx, trigger_bits->add(trigger));
+    else                  trigger_sel = make_unique<TriggerBitSelection>(ctx, trigger_bits->add("HLT_Ele45_CaloIdVT_GsfTrkIdT_PFJet200_PFJet50_v*"));
   }
 
-  jet2_sel.reset(new NJetSelection(2, -1, JetId(PtEtaCut( 50., 2.4))));
-  jet1_sel.reset(new NJetSelection(1, -1, JetId(PtEtaCut(200., 2.4))));
+  /* lazy object reconstruction [dependencies must be declared before the products using them] */
+  products.add("leptons", [this](uhh2::Event& event){
+
+    muo_cleaner->process(event);
+    sort_by_pt<Muon>(*event.muons);
+
+    ele_cleaner->process(event);
+    sort_by_pt<Electron>(*event.electrons);
+
+    lepsum_producer->process(event);
+  });
+
+  products.add("jets25", [this](uhh2::Event& event){
+
+    jet_IDcleaner->process(event);
+    jet_corrector->process(event);
+//!!    jetER_smearer->process(event);
+    jetlepton_cleaner->process(event);
+    jet_cleaner1->process(event); // jet collection for lepton-2Dcut
+    sort_by_pt<Jet>(*event.jets);
+  }, {"leptons"});
+
+  products.add("topjets", [this](uhh2::Event& event){
+
+    topjet_IDcleaner->process(event);
+    topjet_corrector->process(event);
+//!!    topjetER_smearer->process(event);
+    topjetlepton_cleaner->process(event);
+    topjet_cleaner->process(event);
+    sort_by_pt<TopJet>(*event.topjets);
+  }, {"leptons"});
+
+  products.add("view25", [this](uhh2::Event& event){ view25_producer->process(event); }, {"leptons", "jets25", "topjets"});
+
+  // jet_cleaner2 overwrites the pt>25 GeV jet collection: snapshot (view25) taken first
+  products.add("jets30", [this](uhh2::Event& event){
+
+    jet_cleaner2->process(event);
+    sort_by_pt<Jet>(*event.jets);
+  }, {"jets25", "view25"});
 
-  met_sel  .reset(new METCut  ( 50., uhh2::infinity));
-  htlep_sel.reset(new HTlepCut(150., uhh2::infinity));
+  products.add("view", [this](uhh2::Event& event){ view_producer->process(event); }, {"leptons", "jets30", "topjets"});
 
-  twodcut_sel.reset(new TwoDCut(.4, 25.));
+  products.add("viewlep", [this](uhh2::Event& event){ viewlep_producer->process(event); }, {"leptons"});
 
-  if     (channel_ == elec) triangc_sel.reset(new TriangularCuts(1.5, 75.));
+  products.add("vars25" , [this](uhh2::Event& event){ vars25_producer ->process(event); }, {"leptons", "view25"});
+  products.add("vars"   , [this](uhh2::Event& event){ vars_producer   ->process(event); }, {"leptons", "view"});
+  products.add("varslep", [this](uhh2::Event& event){ varslep_producer->process(event); }, {"leptons", "viewlep"});
+  ////
+
+  /* trigger_h: lepton-only hists by default (no jet reconstruction for events failing the lepton selection),
+     jet pt>25 GeV view with "cutflow__lep__jet_hists";
+     lep1_h: filled before jet_cleaner2 (jet pt>25 GeV view), jets reconstructed anyway for the jet cutflow */
+  const std::string& lep_jet_hists = ctx.get("cutflow__lep__jet_hists", "false");
+  if(lep_jet_hists != "true" && lep_jet_hists != "false")
+    throw std::runtime_error("ZprimeSelectionModule -- undefined argument for 'cutflow__lep__jet_hists' key in xml file (must be 'true' or 'false'): "+lep_jet_hists);
+
+  lep_cutflow.reset(new Cutflow("cutflow__lep", &products));
+  if(lep_jet_hists == "true") lep_cutflow->add("trigger", std::move(trigger_sel), make_unique<ZprimeSelectionHists>(ctx, "trigger", "ZprimeEventView__jet25"), {}, {"vars25"});
+  else                        lep_cutflow->add("trigger", std::move(trigger_sel), make_unique<ZprimeSelectionHists>(ctx, "trigger", "ZprimeEventView__lep", "LeptonSummary", false), {}, {"varslep"});
+  lep_cutflow->add("lep1"   , std::move(lep1_sel)   , make_unique<ZprimeSelectionHists>(ctx, "lep1"   , "ZprimeEventView__jet25"), {"leptons"}, {"vars25"});
+  lep_cutflow->finalize(ctx);
+
+  std::unique_ptr<uhh2::Selection> triangc_sel;
+  if     (channel_ == elec) triangc_sel.reset(new TriangularCuts(ctx, 1.5, 75.));
   else if(channel_ == muon) triangc_sel.reset(new uhh2::AndSelection(ctx)); // always true (no triangular cuts for muon channel)
 
+  /* lepton-2Dcut evaluated wrt AK4 jets w/ pt>25 GeV (view before jet_cleaner2) */
+  jet_cutflow.reset(new Cutflow("cutflow__jet", &products));
+  jet_cutflow->add("jet2"   , make_unique<NJetSelection>(2, -1, JetId(PtEtaCut( 50., 2.4))), make_unique<ZprimeSelectionHists>(ctx, "jet2")   , {"jets30"} , {"vars"});
+  jet_cutflow->add("jet1"   , make_unique<NJetSelection>(1, -1, JetId(PtEtaCut(200., 2.4))), make_unique<ZprimeSelectionHists>(ctx, "jet1")   , {"jets30"} , {"vars"});
+  jet_cutflow->add("met"    , make_unique<METCut>  ( 50., uhh2::infinity)                  , make_unique<ZprimeSelectionHists>(ctx, "met")    , {}         , {"vars"});
+  jet_cutflow->add("htlep"  , make_unique<HTlepCut>(ctx, 150., uhh2::infinity)             , make_unique<ZprimeSelectionHists>(ctx, "htlep")  , {"leptons"}, {"vars"});
+  jet_cutflow->add("twodcut", make_unique<TwoDCut> (ctx, .4, 25., "ZprimeEventView__jet25"), make_unique<ZprimeSelectionHists>(ctx, "twodcut"), {"view25"} , {"vars"});
+  jet_cutflow->add("triangc", std::move(triangc_sel)                                        , make_unique<ZprimeSelectionHists>(ctx, "triangc"), {"view"}   , {"vars"});
+  jet_cutflow->finalize(ctx);
+
   /* t-tagging */
   const TopJetId topjetID = AndId<TopJet>(CMSTopTag(CMSTopTag::MassType::groomed), Tau32());
   const float minDR_topjet_jet(1.2);
@@ -220,25 +353,47 @@ ZprimeSelectionModule::ZprimeSelectionModule(uhh2::Context& ctx){
 
   reco_primlep.reset(new PrimaryLepton(ctx));
 
-  ttbar_reco__ttag0.reset(new HighMassTTbarReconstruction(ctx, NeutrinoReconstruction, ttbar_hyps_label));
-  ttbar_reco__ttag1.reset(new        TopTagReconstruction(ctx, NeutrinoReconstruction, ttbar_hyps_label, topjetID, minDR_topjet_jet));
-
-  ttbar_chi2__ttag0.reset(new Chi2Discriminator    (ctx, ttbar_hyps_label));
-  ttbar_chi2__ttag1.reset(new Chi2DiscriminatorTTAG(ctx, ttbar_hyps_label));
+  // "exhaustive": all hypotheses built and scored,
+  // "stream": hypotheses scored while generated (only the "ttbar_reco__top_k" best ones built),
+  // "bnb": as "stream", with branch-and-bound pruning of the jet assignments
+  // (chi2 discriminator slots and best hypothesis computed by the reconstruction, see DiscriminatorSlots)
+  disc_slots.reset(new DiscriminatorSlots);
+  ttbar_reco.reset(new ZprimeTTbarReconstruction(ctx, ttbar_hyps_label, ttbar_chi2_label, topjetID, minDR_topjet_jet, disc_slots));
 
   h_ttbar_hyps = ctx.get_handle<std::vector<ReconstructionHypothesis>>(ttbar_hyps_label);
+  h_ttbar_best = ctx.get_handle<BestHypothesis>(best_hypothesis_label(ttbar_hyps_label, ttbar_chi2_label));
   /**/
 
+  //// FLAT OUTPUT
+  const std::string& flat_output = ctx.get("flat_output", "false");
+  if(flat_output == "true"){
+
+    const FlatPrecision flat_precision(ctx.get("flat__precision", ""));
+    const std::vector<std::string> flat_discriminators = uhh2::split(ctx.get("flat__discriminators", "Chi2,Chi2_tlep,Chi2_thad"), ",");
+
+    flat_writer.reset(new FlatNtupleWriter(ctx, ttbar_hyps_label, flat_precision, flat_discriminators));
+
+    // remove the full collections and hypotheses from output (genInfo kept for the event weights)
+    for(const auto& key : {"PrimaryVertexCollection", "GenParticleCollection", "ElectronCollection", "MuonCollection", "TauCollection",
+                           "JetCollection", "GenJetCollection", "TopJetCollection", "METName"}){
+
+      const std::string& coll = ctx.get(key, "");
+      if(coll != "") ctx.undeclare_event_output(coll);
+    }
+
+    ctx.undeclare_event_output("triggerResults");
+    ctx.undeclare_event_output("triggerNames");
+    ctx.undeclare_event_output("beamspot_x0");
+    ctx.undeclare_event_output("beamspot_y0");
+    ctx.undeclare_event_output("beamspot_z0");
+    ctx.undeclare_event_output("rho");
+    ctx.undeclare_event_output(ttbar_hyps_label);
+  }
+  else if(flat_output != "false") throw std::runtime_error("ZprimeSelectionModule -- undefined argument for 'flat_output' key in xml file (must be 'true' or 'false'): "+flat_output);
+  ////
+
   //// HISTS
   input_h    .reset(new ZprimeSelectionHists(ctx, "input"));
-  trigger_h  .reset(new ZprimeSelectionHists(ctx, "trigger"));
-  lep1_h     .reset(new ZprimeSelectionHists(ctx, "lep1"));
-  jet2_h     .reset(new ZprimeSelectionHists(ctx, "jet2"));
-  jet1_h     .reset(new ZprimeSelectionHists(ctx, "jet1"));
-  met_h      .reset(new ZprimeSelectionHists(ctx, "met"));
-  htlep_h    .reset(new ZprimeSelectionHists(ctx, "htlep"));
-  twodcut_h  .reset(new ZprimeSelectionHists(ctx, "twodcut"));
-  triangc_h  .reset(new ZprimeSelectionHists(ctx, "triangc"));
   toptagevt_h.reset(new ZprimeSelectionHists(ctx, "toptagevent"));
   chi2min_toptag0_h.reset(new HypothesisHists(ctx, "chi2min_toptag0__HypHists", ttbar_hyps_label, ttbar_chi2_label));
   chi2min_toptag1_h.reset(new HypothesisHists(ctx, "chi2min_toptag1__HypHists", ttbar_hyps_label, ttbar_chi2_label));
@@ -260,86 +415,30 @@ bool ZprimeSelectionModule::process(uhh2::Event& event){
   /* luminosity sections from CMS golden-JSON file */
   if(event.isRealData && !lumi_sel->passes(event)) return false;
 
+  /* HLT and MET-filter bits */
+  trigger_bits->process(event);
+
   /* MET filters */
   if(!metfilters_sel->passes(event)) return false;
 
   /* pileup SF */
   if(!event.isRealData) pileup_SF->process(event);
+  for(auto& r : pileup_ratios) r->process(event);
   ////
 
-  // OBJ CLEANING
-  muo_cleaner->process(event);
-  sort_by_pt<Muon>(*event.muons);
-
-  ele_cleaner->process(event);
-  sort_by_pt<Electron>(*event.electrons);
-
-  jet_IDcleaner->process(event);
-  jet_corrector->process(event);
-//!!  jetER_smearer->process(event);
-  jetlepton_cleaner->process(event);
-  jet_cleaner1->process(event); // jet collection for lepton-2Dcut
-  sort_by_pt<Jet>(*event.jets);
-
-  topjet_IDcleaner->process(event);
-  topjet_corrector->process(event);
-//!!  topjetER_smearer->process(event);
-  topjetlepton_cleaner->process(event);
-  topjet_cleaner->process(event);
-  sort_by_pt<TopJet>(*event.topjets);
-
-  //// HLT selection
-  const bool pass_trigger = trigger_sel->passes(event);
-  if(!pass_trigger) return false;
-  trigger_h->fill(event);
-  ////
-
-  //// LEPTON selection
-  const bool pass_lep1 = lep1_sel->passes(event);
-  if(!pass_lep1) return false;
-  lep1_h->fill(event);
-  ////
-
-  //// JET selection
-
-  /* lepton-2Dcut boolean */
-  const bool pass_twodcut = twodcut_sel->passes(event);
-
-  jet_cleaner2->process(event);
-  sort_by_pt<Jet>(*event.jets);
-
-  /* 2nd AK4 jet selection */
-  const bool pass_jet2 = jet2_sel->passes(event);
-  if(!pass_jet2) return false;
-  jet2_h->fill(event);
-
-  /* 1st AK4 jet selection */
-  const bool pass_jet1 = jet1_sel->passes(event);
-  if(!pass_jet1) return false;
-  jet1_h->fill(event);
-  ////
-
-  //// MET selection
-  const bool pass_met = met_sel->passes(event);
-  if(!pass_met) return false;
-  met_h->fill(event);
+  // OBJ CLEANING [lazy: run on request of the cutflow steps]
+  products.reset();
 
-  /* HT_lep selection */
-  const bool pass_htlep = htlep_sel->passes(event);
-  if(!pass_htlep) return false;
-  htlep_h->fill(event);
+  //// HLT + LEPTON selection
+  if(!lep_cutflow->process(event)) return false;
   ////
 
-  //// LEPTON-2Dcut selection
-  if(!pass_twodcut) return false;
-  twodcut_h->fill(event);
+  //// JET, MET, HT_lep, LEPTON-2Dcut, TRIANGULAR-CUTS [e+jets only] selection
+  if(!jet_cutflow->process(event)) return false;
   ////
 
-  //// TRIANGULAR-CUTS selection [e+jets only]
-  const bool pass_triangc = triangc_sel->passes(event);
-  if(!pass_triangc) return false;
-  triangc_h->fill(event);
-  ////
+  // complete object reconstruction for the output ntuple (no-op if already produced)
+  products.require(event, "vars");
 
   /* TOPTAG-EVENT boolean */
   const bool pass_ttagevt = toptagevt_sel->passes(event);
@@ -351,22 +450,27 @@ bool ZprimeSelectionModule::process(uhh2::Event& event){
 
   //// TTBAR KIN RECO
   reco_primlep->process(event);
-  if(!pass_ttagevt){ ttbar_reco__ttag0->process(event); ttbar_chi2__ttag0->process(event); }
-  else             { ttbar_reco__ttag1->process(event); ttbar_chi2__ttag1->process(event); }
+  ttbar_reco->process(event, pass_ttagevt);
   ////
 
   if(!pass_ttagevt) chi2min_toptag0_h->fill(event);
   else              chi2min_toptag1_h->fill(event);
 
   // save only the chi2-best ttbar hypothesis in output sub-ntuple
+  // (moved to the front and the vector truncated: no copy; already at the front for the sorted output of "stream"/"bnb" w/o top-tag)
   std::vector<ReconstructionHypothesis>& hyps = event.get(h_ttbar_hyps);
-  const ReconstructionHypothesis* hyp = get_best_hypothesis(hyps, "Chi2");
-  if(!hyp) std::runtime_error("ZprimeSelectionModule::process -- best hypothesis for ttbar-reconstruction not found");
+  BestHypothesis& best = event.get(h_ttbar_best);
+  if(!best.hyp) throw std::runtime_error("ZprimeSelectionModule::process -- best hypothesis for ttbar-reconstruction not found");
+
+  const size_t ibest = best.hyp - hyps.data();
+  if(ibest) std::swap(hyps.front(), hyps[ibest]);
+  hyps.resize(1);
+  best.hyp = &hyps.front();
 
-  const ReconstructionHypothesis hyp_obj(*hyp);
+  /* b-tag SF ratios (final AK4 jets) */
+  for(auto& r : btag_ratios) r->process(event);
 
-  hyps.clear();
-  hyps.push_back(hyp_obj);
+  if(flat_writer) flat_writer->process(event);
 
   return true;
 }
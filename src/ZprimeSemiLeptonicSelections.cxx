@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 
 #include <UHH2/core/include/LorentzVector.h>
 
@@ -10,11 +11,22 @@
 #include <UHH2/common/include/Utils.h>
 
 uhh2::HTlepCut::HTlepCut(float min_htlep, float max_htlep):
-  min_htlep_(min_htlep), max_htlep_(max_htlep) {}
+  min_htlep_(min_htlep), max_htlep_(max_htlep), use_lepsum_(false) {}
+
+uhh2::HTlepCut::HTlepCut(uhh2::Context& ctx, float min_htlep, float max_htlep, const std::string& lepsum):
+  min_htlep_(min_htlep), max_htlep_(max_htlep), use_lepsum_(true), h_lepsum_(ctx.get_handle<LeptonSummary>(lepsum)) {}
 
 bool uhh2::HTlepCut::passes(const uhh2::Event& event){
 
-  float htlep = HTlep1(event);
+  float htlep(0.);
+  if(use_lepsum_){
+
+    const LeptonSummary& lepsum = event.get(h_lepsum_);
+    if(!lepsum.lep1) return false;
+
+    htlep = lepsum.HTlep1;
+  }
+  else htlep = HTlep1(event);
 
   return (htlep > min_htlep_) && (htlep < max_htlep_);
 }
@@ -33,21 +45,46 @@ bool uhh2::METCut::passes(const uhh2::Event& event){
 ////////////////////////////////////////////////////////
 
 uhh2::NJetCut::NJetCut(int nmin_, int nmax_, float ptmin_, float etamax_):
-  nmin(nmin_), nmax(nmax_), ptmin(ptmin_), etamax(etamax_) {}
+  nmin(nmin_), nmax(nmax_), ptmin(ptmin_), etamax(etamax_), use_view_(false) {}
+
+uhh2::NJetCut::NJetCut(uhh2::Context& ctx, int nmin_, int nmax_, float ptmin_, float etamax_, const std::string& view):
+  nmin(nmin_), nmax(nmax_), ptmin(ptmin_), etamax(etamax_), use_view_(true), h_view_(ctx.get_handle<ZprimeEventView>(view)) {}
 
 bool uhh2::NJetCut::passes(const uhh2::Event& event){
 
   int njet(0);
-  for(auto & jet : *event.jets){
-    if(jet.pt() > ptmin && fabs(jet.eta()) < etamax) ++njet;
+  if(use_view_){
+
+    const ParticleArrays& jets = event.get(h_view_).jets;
+    for(size_t i=0; i<jets.size(); ++i) njet += (jets.pt[i] > ptmin && fabs(jets.eta[i]) < etamax);
+  }
+  else {
+
+    for(auto & jet : *event.jets){
+      if(jet.pt() > ptmin && fabs(jet.eta()) < etamax) ++njet;
+    }
   }
 
   return (njet >= nmin) && (njet <= nmax);
 }
 ////////////////////////////////////////////////////////
 
+uhh2::TwoDCut1::TwoDCut1(uhh2::Context& ctx, float min_deltaR, float min_pTrel, const std::string& view, const std::string& lepsum):
+  min_deltaR_(min_deltaR), min_pTrel_(min_pTrel), use_view_(true), h_view_(ctx.get_handle<ZprimeEventView>(view)), h_lepsum_(ctx.get_handle<LeptonSummary>(lepsum)) {}
+
 bool uhh2::TwoDCut1::passes(const uhh2::Event& event){
 
+  if(use_view_){
+
+    const LeptonSummary& lepsum = event.get(h_lepsum_);
+    if(!lepsum.lep1) throw std::runtime_error("TwoDCut1::passes -- pt-leading lepton not found");
+
+    float drmin, ptrel;
+    std::tie(drmin, ptrel) = drmin_pTrel(lepsum.lep1_pt, lepsum.lep1_eta, lepsum.lep1_phi, event.get(h_view_).jets);
+
+    return (drmin > min_deltaR_) || (ptrel > min_pTrel_);
+  }
+
   assert(event.muons && event.electrons && event.jets);
 
   const Particle* lepton = leading_lepton(event);
@@ -59,8 +96,29 @@ bool uhh2::TwoDCut1::passes(const uhh2::Event& event){
 }
 ////////////////////////////////////////////////////////
 
+uhh2::TwoDCutALL::TwoDCutALL(uhh2::Context& ctx, float min_deltaR, float min_pTrel, const std::string& view):
+  min_deltaR_(min_deltaR), min_pTrel_(min_pTrel), use_view_(true), h_view_(ctx.get_handle<ZprimeEventView>(view)) {}
+
 bool uhh2::TwoDCutALL::passes(const uhh2::Event& event){
 
+  if(use_view_){
+
+    const ZprimeEventView& view = event.get(h_view_);
+
+    for(const ParticleArrays* leps : {&view.muons, &view.electrons}){
+      for(size_t i=0; i<leps->size(); ++i){
+
+        float drmin, ptrel;
+        std::tie(drmin, ptrel) = drmin_pTrel(leps->pt[i], leps->eta[i], leps->phi[i], view.jets);
+
+        const bool pass = (drmin > min_deltaR_) || (ptrel > min_pTrel_);
+        if(!pass) return false;
+      }
+    }
+
+    return true;
+  }
+
   assert(event.muons && event.electrons && event.jets);
 
   for(const auto& muo : *event.muons){
@@ -85,15 +143,32 @@ bool uhh2::TwoDCutALL::passes(const uhh2::Event& event){
 }
 ////////////////////////////////////////////////////////
 
+uhh2::TwoDCut::TwoDCut(uhh2::Context& ctx, float min_deltaR, float min_pTrel, const std::string& view, const std::string& lepsum):
+  min_deltaR_(min_deltaR), min_pTrel_(min_pTrel), use_view_(true), h_view_(ctx.get_handle<ZprimeEventView>(view)), h_lepsum_(ctx.get_handle<LeptonSummary>(lepsum)) {}
+
 bool uhh2::TwoDCut::passes(const uhh2::Event& event){
 
+  float drmin, ptrel;
+
+  if(use_view_){
+
+    const LeptonSummary& lepsum = event.get(h_lepsum_);
+    if((lepsum.muoN+lepsum.eleN) != 1){
+      std::cout << "\n @@@ WARNING -- TwoDCut::passes -- unexpected number of muons+electrons in the event (!=1). returning 'false'\n";
+      return false;
+    }
+
+    std::tie(drmin, ptrel) = drmin_pTrel(lepsum.lep1_pt, lepsum.lep1_eta, lepsum.lep1_phi, event.get(h_view_).jets);
+
+    return (drmin > min_deltaR_) || (ptrel > min_pTrel_);
+  }
+
   assert(event.muons && event.electrons && event.jets);
   if((event.muons->size()+event.electrons->size()) != 1){
     std::cout << "\n @@@ WARNING -- TwoDCut::passes -- unexpected number of muons+electrons in the event (!=1). returning 'false'\n";
     return false;
   }
 
-  float drmin, ptrel;  
   if(event.muons->size()) std::tie(drmin, ptrel) = drmin_pTrel(event.muons->at(0), *event.jets);
   else std::tie(drmin, ptrel) = drmin_pTrel(event.electrons->at(0), *event.jets);
 
@@ -101,13 +176,41 @@ bool uhh2::TwoDCut::passes(const uhh2::Event& event){
 }
 ////////////////////////////////////////////////////////
 
-uhh2::TriangularCuts::TriangularCuts(float a, float b): a_(a), b_(b) {
+uhh2::TriangularCuts::TriangularCuts(float a, float b): a_(a), b_(b), use_view_(false) {
+
+  if(!b_) throw std::runtime_error("TriangularCuts -- incorrect initialization (parameter 'b' is null)");
+}
+
+uhh2::TriangularCuts::TriangularCuts(uhh2::Context& ctx, float a, float b, const std::string& view, const std::string& lepsum):
+  a_(a), b_(b), use_view_(true), h_view_(ctx.get_handle<ZprimeEventView>(view)), h_lepsum_(ctx.get_handle<LeptonSummary>(lepsum)) {
 
-  if(!b_) std::runtime_error("TriangularCuts -- incorrect initialization (parameter 'b' is null)");
+  if(!b_) throw std::runtime_error("TriangularCuts -- incorrect initialization (parameter 'b' is null)");
 }
 
 bool uhh2::TriangularCuts::passes(const uhh2::Event& event){
 
+  if(use_view_){
+
+    const ZprimeEventView& view = event.get(h_view_);
+    const LeptonSummary& lepsum = event.get(h_lepsum_);
+
+    if((lepsum.muoN+lepsum.eleN) != 1){
+      std::cout << "\n @@@ WARNING -- TriangularCuts::passes -- unexpected number of muons+electrons in the event (!=1). returning 'false'\n";
+      return false;
+    }
+
+    // no jets: MET-jet cut undefined, event rejected (expected when the cut runs before the jet-multiplicity cuts, e.g. adaptive Cutflow)
+    if(!view.jets.size()) return false;
+
+    // MET-lepton triangular cut
+    bool pass_tc_lep = fabs(delta_phi(view.met_phi, lepsum.lep1_phi) - a_) < a_/b_ * view.met_pt;
+
+    // MET-jet triangular cut
+    bool pass_tc_jet = fabs(delta_phi(view.met_phi, view.jets.phi[0]) - a_) < a_/b_ * view.met_pt;
+
+    return pass_tc_lep && pass_tc_jet;
+  }
+
   assert(event.muons || event.electrons);
   assert(event.jets && event.met);
 
@@ -116,10 +219,8 @@ bool uhh2::TriangularCuts::passes(const uhh2::Event& event){
     return false;
   }
 
-  if(!event.jets->size()){
-    std::cout << "\n @@@ WARNING -- TriangularCuts::passes -- unexpected number of jets in the event (==0). returning 'false'\n";
-    return false;
-  }
+  // no jets: MET-jet cut undefined, event rejected (expected when the cut runs before the jet-multiplicity cuts, e.g. adaptive Cutflow)
+  if(!event.jets->size()) return false;
 
   // pt-leading charged lepton
   const Particle* lep1 = leading_lepton(event);
@@ -139,7 +240,7 @@ bool uhh2::TriangularCuts::passes(const uhh2::Event& event){
 
 uhh2::TriangularCutsELE::TriangularCutsELE(float a, float b): a_(a), b_(b) {
 
-  if(!b_) std::runtime_error("TriangularCuts -- incorrect initialization (parameter 'b' is null)");
+  if(!b_) throw std::runtime_error("TriangularCuts -- incorrect initialization (parameter 'b' is null)");
 }
 
 bool uhh2::TriangularCutsELE::passes(const uhh2::Event& event){
@@ -217,13 +318,13 @@ bool uhh2::TopTagEventSelection::passes(const uhh2::Event& event){
 ////////////////////////////////////////////////////////
 
 uhh2::LeptonicTopPtCut::LeptonicTopPtCut(uhh2::Context& ctx, float pt_min, float pt_max, const std::string& hyps_name, const std::string& disc_name):
-  tlep_pt_min_(pt_min), tlep_pt_max_(pt_max), h_hyps_(ctx.get_handle<std::vector<ReconstructionHypothesis>>(hyps_name)), disc_name_(disc_name) {}
+  tlep_pt_min_(pt_min), tlep_pt_max_(pt_max), h_hyps_(ctx.get_handle<std::vector<ReconstructionHypothesis>>(hyps_name)),
+  h_best_(ctx.get_handle<BestHypothesis>(best_hypothesis_label(hyps_name, disc_name))), disc_name_(disc_name) {}
 
 bool uhh2::LeptonicTopPtCut::passes(const uhh2::Event& event){
 
-  std::vector<ReconstructionHypothesis> hyps = event.get(h_hyps_);
-  const ReconstructionHypothesis* hyp = get_best_hypothesis(hyps, disc_name_);
-  if(!hyp) std::runtime_error("LeptonicTopPtCut -- best hypothesis not found (discriminator="+disc_name_+")");
+  const ReconstructionHypothesis* hyp = get_best_hypothesis(event, h_hyps_, h_best_, disc_name_);
+  if(!hyp) throw std::runtime_error("LeptonicTopPtCut -- best hypothesis not found (discriminator="+disc_name_+")");
 
   float tlep_pt = hyp->toplep_v4().Pt();
 
@@ -232,13 +333,33 @@ bool uhh2::LeptonicTopPtCut::passes(const uhh2::Event& event){
 ////////////////////////////////////////////////////////
 
 uhh2::HypothesisDiscriminatorCut::HypothesisDiscriminatorCut(uhh2::Context& ctx, float disc_min, float disc_max, const std::string& hyps_name, const std::string& disc_bhyp, const std::string& disc_cut):
-  disc_min_(disc_min), disc_max_(disc_max), h_hyps_(ctx.get_handle<std::vector<ReconstructionHypothesis>>(hyps_name)), disc_bhyp_(disc_bhyp), disc_cut_(disc_cut) {}
+  disc_min_(disc_min), disc_max_(disc_max), h_hyps_(ctx.get_handle<std::vector<ReconstructionHypothesis>>(hyps_name)),
+  h_best_(ctx.get_handle<BestHypothesis>(best_hypothesis_label(hyps_name, disc_bhyp))), disc_bhyp_(disc_bhyp), disc_cut_(disc_cut),
+  slot_cut_(-1) {}
+
+uhh2::HypothesisDiscriminatorCut::HypothesisDiscriminatorCut(uhh2::Context& ctx, float disc_min, float disc_max, const std::string& hyps_name, DiscriminatorSlots& slots,
+                                                             const std::string& disc_bhyp, const std::string& disc_cut):
+  HypothesisDiscriminatorCut(ctx, disc_min, disc_max, hyps_name, disc_bhyp, disc_cut) {
+
+  slot_cut_ = slots.add(disc_cut_);
+}
 
 bool uhh2::HypothesisDiscriminatorCut::passes(const uhh2::Event& event){
 
-  std::vector<ReconstructionHypothesis> hyps = event.get(h_hyps_);
-  const ReconstructionHypothesis* hyp = get_best_hypothesis(hyps, disc_bhyp_);
-  if(!hyp) std::runtime_error("HypothesisDiscriminatorCut -- best hypothesis not found (discriminator="+disc_bhyp_+")");
+  if(slot_cut_ >= 0){
+
+    const BestHypothesis& best = event.get(h_best_);
+    if(!best.current(event)) throw std::runtime_error("HypothesisDiscriminatorCut -- BestHypothesis product not filled for the current event");
+    if(!best.hyp) throw std::runtime_error("HypothesisDiscriminatorCut -- best hypothesis not found (discriminator="+disc_bhyp_+")");
+    if(size_t(slot_cut_) >= best.disc.size()) throw std::runtime_error("HypothesisDiscriminatorCut -- discriminator slot not filled by the BestHypothesisProducer (discriminator="+disc_cut_+")");
+
+    const float disc_val = best.disc[slot_cut_];
+
+    return (disc_val > disc_min_) && (disc_val < disc_max_);
+  }
+
+  const ReconstructionHypothesis* hyp = get_best_hypothesis(event, h_hyps_, h_best_, disc_bhyp_);
+  if(!hyp) throw std::runtime_error("HypothesisDiscriminatorCut -- best hypothesis not found (discriminator="+disc_bhyp_+")");
 
   float disc_val = hyp->discriminator(disc_cut_);
 
@@ -261,3 +382,14 @@ bool uhh2::GenMttbarCut::passes(const uhh2::Event& event){
   return (mttbar_min_ < mttbargen) && (mttbargen < mttbar_max_);
 }
 ////////////////////////////////////////////////////////
+
+uhh2::TriggerBitSelection::TriggerBitSelection(uhh2::Context& ctx, const uint64_t mask, const bool require_all, const std::string& label):
+  mask_(mask), require_all_(require_all), h_bits_(ctx.get_handle<uint64_t>(label)) {}
+
+bool uhh2::TriggerBitSelection::passes(const uhh2::Event& event){
+
+  const uint64_t bits = event.get(h_bits_) & mask_;
+
+  return require_all_ ? (bits == mask_) : (bits != 0);
+}
+////////////////////////////////////////////////////////
@@ -1,76 +1,76 @@
 #include <UHH2/ZprimeSemiLeptonic/include/ZprimeSemiLeptonicUtils.h>
 #include <UHH2/core/include/LorentzVector.h>
+#include <UHH2/common/include/ReconstructionHypothesisDiscriminators.h>
 
-bool JetLeptonDeltaRCleaner::process(uhh2::Event& event){
+#include <cmath>
+#include <limits>
+#include <stdexcept>
 
-  assert(event.jets);
-  std::vector<Jet> cleaned_jets;
+void deltaR2_row(float* dr2, const float eta, const float phi, const float* etas, const float* phis, const size_t n){
 
-  for(const auto & tjet : *event.jets){
-    bool skip_tjet(false);
+  // branch-free body over contiguous arrays (the select below compiles to a vector min; keep this form)
+  const float twopi(2*M_PI);
 
-    if(event.muons){
-      for(const auto & muo : *event.muons)
-        if(uhh2::deltaR(tjet, muo) < minDR_) skip_tjet = true;
-    }
-
-    if(skip_tjet) continue;
+  for(size_t j=0; j<n; ++j){
 
-    if(event.electrons){
-      for(const auto & ele : *event.electrons)
-        if(uhh2::deltaR(tjet, ele) < minDR_) skip_tjet = true;
-    }
+    const float deta = eta - etas[j];
+    const float adphi = std::fabs(phi - phis[j]);
+    const float dphi = (twopi - adphi < adphi) ? (twopi - adphi) : adphi;
 
-    if(!skip_tjet) cleaned_jets.push_back(tjet);
+    dr2[j] = deta*deta + dphi*dphi;
   }
 
-  event.jets->clear();
-  event.jets->reserve(cleaned_jets.size());
-  for(const auto& j : cleaned_jets) event.jets->push_back(j);
+  return;
+}
 
-  return true;
+void deltaR2_matrix(std::vector<float>& dr2, const ParticleArrays& rows, const ParticleArrays& cols){
+
+  const size_t ncol(cols.size());
+  dr2.resize(rows.size() * ncol);
+
+  for(size_t i=0; i<rows.size(); ++i)
+    deltaR2_row(dr2.data() + i*ncol, rows.eta[i], rows.phi[i], cols.eta.data(), cols.phi.data(), ncol);
+
+  return;
 }
 
-bool TopJetLeptonDeltaRCleaner::process(uhh2::Event& event){
+void flag_deltaR_overlaps(std::vector<char>& overlap, const ParticleArrays& coll, const ParticleArrays& ref, const float mindr, std::vector<float>& dr2_buffer){
 
-  assert(event.topjets);
-  std::vector<TopJet> cleaned_topjets;
+  assert(overlap.size() == coll.size());
 
-  for(const auto & tjet : *event.topjets){
-    bool skip_tjet(false);
+  if(!coll.size() || !ref.size()) return;
 
-    if(event.muons){
-      for(const auto & muo : *event.muons)
-        if(uhh2::deltaR(tjet, muo) < minDR_) skip_tjet = true;
-    }
+  // one row per reference particle, columns run over the (longer) collection to be cleaned
+  deltaR2_matrix(dr2_buffer, ref, coll);
 
-    if(skip_tjet) continue;
+  const float mindr2(mindr*mindr);
+  const size_t ncol(coll.size());
 
-    if(event.electrons){
-      for(const auto & ele : *event.electrons)
-        if(uhh2::deltaR(tjet, ele) < minDR_) skip_tjet = true;
-    }
+  for(size_t i=0; i<ref.size(); ++i){
 
-    if(!skip_tjet) cleaned_topjets.push_back(tjet);
+    const float* row = dr2_buffer.data() + i*ncol;
+    for(size_t j=0; j<ncol; ++j) overlap[j] |= (row[j] < mindr2);
   }
 
-  event.topjets->clear();
-  event.topjets->reserve(cleaned_topjets.size());
-  for(const auto& j : cleaned_topjets) event.topjets->push_back(j);
-
-  return true;
+  return;
 }
 
 const Particle* leading_lepton(const uhh2::Event& event){
 
+  const Particle* lep = find_leading_lepton(event);
+  if(!lep) throw std::runtime_error("leading_lepton -- pt-leading lepton not found");
+
+  return lep;
+}
+
+const Particle* find_leading_lepton(const uhh2::Event& event){
+
   const Particle* lep(0);
 
   float ptL_max(0.);
   if(event.muons)    { for(const auto& mu : *event.muons)    { if(mu.pt() > ptL_max){ ptL_max = mu.pt(); lep = &mu; } } }
   if(event.electrons){ for(const auto& el : *event.electrons){ if(el.pt() > ptL_max){ ptL_max = el.pt(); lep = &el; } } }
 
-  if(!lep) throw std::runtime_error("leading_lepton -- pt-leading lepton not found");
-
   return lep;
 }
 
@@ -94,3 +94,204 @@ float HTlep1(const uhh2::Event& event){
 
   return (leading_lepton(event)->pt() + event.met->pt());
 }
+
+void LeptonSummary::fill(const uhh2::Event& event){
+
+  assert(event.muons && event.electrons && event.met);
+
+  lep1 = 0;
+  float ptL_max(0.), ptL_sum(0.);
+
+  for(const auto& mu : *event.muons)    { ptL_sum += mu.pt(); if(mu.pt() > ptL_max){ ptL_max = mu.pt(); lep1 = &mu; } }
+  for(const auto& el : *event.electrons){ ptL_sum += el.pt(); if(el.pt() > ptL_max){ ptL_max = el.pt(); lep1 = &el; } }
+
+  muoN = event.muons    ->size();
+  eleN = event.electrons->size();
+
+  lep1_pt  = lep1 ? lep1->pt()  : 0.;
+  lep1_eta = lep1 ? lep1->eta() : 0.;
+  lep1_phi = lep1 ? lep1->phi() : 0.;
+
+  HTlep  = ptL_sum + event.met->pt();
+  HTlep1 = lep1 ? (lep1_pt + event.met->pt()) : 0.;
+
+  return;
+}
+
+LeptonSummaryProducer::LeptonSummaryProducer(uhh2::Context& ctx, const std::string& label):
+  h_lepsum_(ctx.get_handle<LeptonSummary>(label)) {}
+
+bool LeptonSummaryProducer::process(uhh2::Event& event){
+
+  LeptonSummary lepsum;
+  lepsum.fill(event);
+
+  event.set(h_lepsum_, lepsum);
+
+  return true;
+}
+////////////////////////////////////////////////////////
+
+WeightRatioProducer::WeightRatioProducer(uhh2::Context& ctx, const std::string& label, std::unique_ptr<uhh2::AnalysisModule> nominal, std::unique_ptr<uhh2::AnalysisModule> varied):
+  h_ratio_(ctx.declare_event_output<float>(label)), nominal_(std::move(nominal)), varied_(std::move(varied)) {
+
+  if(!nominal_ || !varied_) throw std::runtime_error("WeightRatioProducer::WeightRatioProducer -- null weight module for output: "+label);
+}
+
+bool WeightRatioProducer::process(uhh2::Event& event){
+
+  const double weight(event.weight);
+
+  event.weight = 1.;
+  nominal_->process(event);
+  const double w_nominal(event.weight);
+
+  event.weight = 1.;
+  varied_->process(event);
+  const double w_varied(event.weight);
+
+  event.weight = weight;
+
+  event.set(h_ratio_, float(w_nominal != 0. ? w_varied/w_nominal : 1.));
+
+  return true;
+}
+////////////////////////////////////////////////////////
+
+BestHypothesisProducer::BestHypothesisProducer(uhh2::Context& ctx, const std::string& hyps, const std::string& disc, const std::shared_ptr<const DiscriminatorSlots>& slots):
+  h_hyps_(ctx.get_handle<std::vector<ReconstructionHypothesis>>(hyps)),
+  h_best_(ctx.get_handle<BestHypothesis>(best_hypothesis_label(hyps, disc))), disc_(disc), slots_(slots) {}
+
+bool BestHypothesisProducer::process(uhh2::Event& event){
+
+  // product filled in place (slot values reuse the storage of the previous event)
+  if(!event.is_valid(h_best_)) event.set(h_best_, BestHypothesis());
+  BestHypothesis& best = event.get(h_best_);
+
+  // single hypothesis of the ZprimeSelectionModule output: taken as is, search only for longer vectors
+  const std::vector<ReconstructionHypothesis>& hyps = event.get(h_hyps_);
+  best.hyp = (hyps.size() == 1) ? &hyps.front() : ::get_best_hypothesis(hyps, disc_);
+  best.run   = event.run;
+  best.lumi  = event.luminosityBlock;
+  best.event = event.event;
+
+  // string lookups of the slot discriminators: once per event, best hypothesis only
+  best.disc.clear();
+  if(slots_ && best.hyp){
+
+    for(size_t j=0; j<slots_->size(); ++j){
+
+      const std::string& name = slots_->name(j);
+      best.disc.push_back(best.hyp->has_discriminator(name) ? best.hyp->discriminator(name) : std::numeric_limits<float>::infinity());
+    }
+  }
+
+  return true;
+}
+
+const ReconstructionHypothesis* get_best_hypothesis(const uhh2::Event& event, const uhh2::Event::Handle<std::vector<ReconstructionHypothesis>>& h_hyps,
+                                                    const uhh2::Event::Handle<BestHypothesis>& h_best, const std::string& disc){
+
+  if(event.is_valid(h_best)){
+
+    const BestHypothesis& best = event.get(h_best);
+    if(best.current(event)) return best.hyp;
+  }
+
+  return get_best_hypothesis(event.get(h_hyps), disc);
+}
+////////////////////////////////////////////////////////
+
+int DiscriminatorSlots::add(const std::string& name){
+
+  for(size_t i=0; i<names_.size(); ++i){
+    if(names_[i] == name) return i;
+  }
+
+  names_.push_back(name);
+
+  return names_.size()-1;
+}
+////////////////////////////////////////////////////////
+
+TriggerBitIndex::TriggerBitIndex(uhh2::Context& ctx, const std::string& label):
+  h_bits_(ctx.get_handle<uint64_t>(label)), resolved_(false), probe_runid_(-1) {}
+
+uint64_t TriggerBitIndex::add(const std::string& pattern){
+
+  for(size_t i=0; i<patterns_.size(); ++i){
+    if(patterns_[i] == pattern) return (uint64_t(1) << i);
+  }
+
+  if(patterns_.size() == 64) throw std::runtime_error("TriggerBitIndex::add -- maximum number of trigger paths (64) exceeded: "+pattern);
+
+  patterns_.push_back(pattern);
+  resolved_ = false;
+
+  return (uint64_t(1) << (patterns_.size()-1));
+}
+
+void TriggerBitIndex::resolve(const uhh2::Event& event){
+
+  const std::vector<std::string> names = event.get_current_triggernames();
+  if(names.empty()) throw std::runtime_error("TriggerBitIndex::resolve -- empty list of trigger names");
+
+  indices_   .clear();
+  index_bits_.clear();
+
+  for(size_t i=0; i<patterns_.size(); ++i){
+
+    const size_t nidx(indices_.size());
+
+    for(const auto& name : names){
+
+      if(!glob_match(patterns_[i], name)) continue;
+
+      indices_   .push_back(event.get_trigger_index(name));
+      index_bits_.push_back(uint64_t(1) << i);
+    }
+
+    if(indices_.size() == nidx) throw std::runtime_error("TriggerBitIndex::resolve -- no trigger name matching pattern: "+patterns_[i]);
+  }
+
+  probe_ = event.get_trigger_index(names.front());
+  event.lookup_trigger_index(probe_);
+  probe_runid_ = probe_.runid;
+
+  resolved_ = true;
+
+  return;
+}
+
+bool TriggerBitIndex::process(uhh2::Event& event){
+
+  // re-resolve only if the trigger-names list changed (cached lookup of the probe index is O(1) otherwise)
+  if(!resolved_ || !event.lookup_trigger_index(probe_) || probe_.runid != probe_runid_) resolve(event);
+
+  uint64_t bits(0);
+  for(size_t i=0; i<indices_.size(); ++i){
+    if(event.passes_trigger(indices_[i])) bits |= index_bits_[i];
+  }
+
+  event.set(h_bits_, bits);
+
+  return true;
+}
+
+bool glob_match(const std::string& pattern, const std::string& name){
+
+  // iterative matching with backtracking to the last '*'
+  size_t p(0), n(0), star(std::string::npos), mark(0);
+
+  while(n < name.size()){
+
+    if(p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])){ ++p; ++n; }
+    else if(p < pattern.size() && pattern[p] == '*'){ star = p++; mark = n; }
+    else if(star != std::string::npos){ p = star+1; n = ++mark; }
+    else return false;
+  }
+
+  while(p < pattern.size() && pattern[p] == '*') ++p;
+
+  return (p == pattern.size());
+}
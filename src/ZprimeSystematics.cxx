@@ -0,0 +1,225 @@
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeSystematics.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+
+#include <UHH2/core/include/Utils.h>
+
+#include <UHH2/common/include/JetCorrections.h>
+
+namespace {
+
+  // corrector module built with the given direction of the context key <key> (e.g. "jecsmear_direction")
+  template<typename T, typename... Args>
+  std::unique_ptr<uhh2::AnalysisModule> make_directed(uhh2::Context& ctx, const std::string& key, const std::string& dir, Args&&... args){
+
+    const std::string nominal = ctx.get(key, "nominal");
+
+    ctx.set(key, dir);
+    std::unique_ptr<uhh2::AnalysisModule> module(new T(ctx, std::forward<Args>(args)...));
+    ctx.set(key, nominal);
+
+    return module;
+  }
+
+  // in-place permutation: coll[k] <- coll[order[k]]
+  template<typename T>
+  void permute(std::vector<T>& coll, const std::vector<size_t>& order){
+
+    std::vector<bool> done(coll.size(), false);
+    for(size_t i=0; i<coll.size(); ++i){
+
+      if(done[i] || order[i] == i){ done[i] = true; continue; }
+
+      T tmp(std::move(coll[i]));
+      size_t j(i);
+      while(true){
+
+        done[j] = true;
+        const size_t k = order[j];
+        if(k == i){ coll[j] = std::move(tmp); break; }
+        coll[j] = std::move(coll[k]);
+        j = k;
+      }
+    }
+
+    return;
+  }
+
+  // pt-ordering and thresholds (pt > cut.first && |eta| < cut.second, as PtEtaCut) after the variation:
+  // entries failing the thresholds moved to 'dropped' (order left empty if unchanged)
+  template<typename T>
+  void sort_by_pt(std::vector<T>& coll, std::vector<size_t>& order, std::vector<T>& dropped, const std::pair<float, float>& cut){
+
+    order.clear();
+    dropped.clear();
+
+    const auto pass  = [&cut](const T& a){ return a.pt() > cut.first && std::fabs(a.eta()) < cut.second; };
+    const auto by_pt = [](const T& a, const T& b){ return a.pt() > b.pt(); };
+    if(std::is_sorted(coll.begin(), coll.end(), by_pt) && std::all_of(coll.begin(), coll.end(), pass)) return;
+
+    // passing entries first, each group in pt-order
+    std::vector<char> ok(coll.size());
+    for(size_t i=0; i<coll.size(); ++i) ok[i] = pass(coll[i]);
+
+    order.resize(coll.size());
+    for(size_t i=0; i<order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&coll, &ok](const size_t a, const size_t b){ return ok[a] != ok[b] ? ok[a] > ok[b] : coll[a].pt() > coll[b].pt(); });
+
+    permute(coll, order);
+
+    const auto npass = std::count(ok.begin(), ok.end(), 1);
+    dropped.assign(std::make_move_iterator(coll.begin()+npass), std::make_move_iterator(coll.end()));
+    coll.erase(coll.begin()+npass, coll.end());
+
+    return;
+  }
+
+  template<typename T>
+  void unsort(std::vector<T>& coll, const std::vector<size_t>& order, std::vector<T>& dropped){
+
+    coll.insert(coll.end(), std::make_move_iterator(dropped.begin()), std::make_move_iterator(dropped.end()));
+    dropped.clear();
+
+    if(order.empty()) return;
+
+    std::vector<size_t> inverse(order.size());
+    for(size_t k=0; k<order.size(); ++k) inverse[order[k]] = k;
+
+    permute(coll, inverse);
+
+    return;
+  }
+}
+
+ZprimeVariationEngine::ZprimeVariationEngine(uhh2::Context& ctx, const std::string& key, const std::vector<std::string>& jec_ak4, const std::vector<std::string>& jec_ak8,
+                                             const std::pair<float, float>& jet_cut, const std::pair<float, float>& topjet_cut):
+  applied_(false), jets_changed_(false), topjets_changed_(false), nominal_weight_(1.), jet_cut_(jet_cut), topjet_cut_(topjet_cut) {
+
+  const std::string cfg = ctx.get(key, "");
+  if(cfg == "") return;
+
+  const bool isMC = (ctx.get("dataset_type") == "MC");
+
+  for(const auto& tok : uhh2::split(cfg, ",")){
+
+    const auto fields = uhh2::split(tok, ":");
+    if(fields.empty() || fields.at(0) == "") throw std::runtime_error("ZprimeVariationEngine::ZprimeVariationEngine -- empty variation name in '"+key+"': "+cfg);
+
+    ZprimeVariation var;
+    var.name = fields.at(0);
+    var.jet_scale    = 1.;
+    var.topjet_scale = 1.;
+
+    for(size_t i=1; i<fields.size(); ++i){
+
+      const auto kv = uhh2::split(fields.at(i), "=");
+      if(kv.size() != 2) throw std::runtime_error("ZprimeVariationEngine::ZprimeVariationEngine -- invalid field for variation '"+var.name+"': "+fields.at(i));
+
+      if     (kv.at(0) == "jec")     var.jec          = kv.at(1);
+      else if(kv.at(0) == "jer")     var.jer          = kv.at(1);
+      else if(kv.at(0) == "jets")    var.jet_scale    = std::stod(kv.at(1));
+      else if(kv.at(0) == "topjets") var.topjet_scale = std::stod(kv.at(1));
+      else if(kv.at(0) == "weight")  var.weight       = kv.at(1);
+      else throw std::runtime_error("ZprimeVariationEngine::ZprimeVariationEngine -- unknown field for variation '"+var.name+"': "+kv.at(0));
+    }
+
+    if(var.jec != "" && var.jec != "up" && var.jec != "down")
+      throw std::runtime_error("ZprimeVariationEngine::ZprimeVariationEngine -- invalid JEC direction for variation '"+var.name+"' (must be 'up' or 'down'): "+var.jec);
+
+    if(var.jer != "" && var.jer != "nominal" && var.jer != "up" && var.jer != "down")
+      throw std::runtime_error("ZprimeVariationEngine::ZprimeVariationEngine -- invalid JER direction for variation '"+var.name+"' (must be 'nominal', 'up' or 'down'): "+var.jer);
+
+    for(const auto& v : vars_)
+      if(v.name == var.name) throw std::runtime_error("ZprimeVariationEngine::ZprimeVariationEngine -- variation already defined: "+var.name);
+
+    h_weights_.push_back(isMC && var.weight != "" ? ctx.declare_event_input<float>(var.weight) : uhh2::Event::Handle<float>());
+
+    jet_correctors_   .emplace_back(isMC && var.jec != "" ? make_directed<JetCorrector>   (ctx, "jecsmear_direction", var.jec, jec_ak4) : nullptr);
+    topjet_correctors_.emplace_back(isMC && var.jec != "" ? make_directed<TopJetCorrector>(ctx, "jecsmear_direction", var.jec, jec_ak8) : nullptr);
+    jer_smearers_     .emplace_back(isMC && var.jer != "" ? make_directed<JetResolutionSmearer>(ctx, "jersmear_direction", var.jer) : nullptr);
+
+    vars_.push_back(var);
+  }
+}
+
+void ZprimeVariationEngine::apply(uhh2::Event& event, const size_t i){
+
+  if(applied_) throw std::runtime_error("ZprimeVariationEngine::apply -- variation already applied (missing call to restore)");
+
+  const ZprimeVariation& var = vars_.at(i);
+
+  nominal_weight_ = event.weight;
+  applied_ = true;
+
+  jets_changed_    = false;
+  topjets_changed_ = false;
+  jet_order_   .clear();
+  topjet_order_.clear();
+
+  // nominal content restored if a corrector throws (the scope destructor is not run for a failed apply)
+  try {
+
+    if(var.changes_jets()){
+
+      assert(event.jets);
+      save_jet_states(*event.jets, jet_states_);
+      jets_changed_ = true;
+
+      if(jet_correctors_.at(i)) jet_correctors_.at(i)->process(event);
+      if(jer_smearers_  .at(i)) jer_smearers_  .at(i)->process(event);
+      if(var.jet_scale != 1.) for(auto& j : *event.jets) j.set_v4(j.v4() * var.jet_scale);
+
+      sort_by_pt(*event.jets, jet_order_, jets_dropped_, jet_cut_);
+    }
+
+    if(var.changes_topjets()){
+
+      assert(event.topjets);
+      save_jet_states(*event.topjets, topjet_states_);
+      topjets_changed_ = true;
+
+      if(topjet_correctors_.at(i)) topjet_correctors_.at(i)->process(event);
+      if(var.topjet_scale != 1.) for(auto& tj : *event.topjets) tj.set_v4(tj.v4() * var.topjet_scale);
+
+      sort_by_pt(*event.topjets, topjet_order_, topjets_dropped_, topjet_cut_);
+    }
+
+    if(!event.isRealData && var.weight != "") event.weight *= event.get(h_weights_.at(i));
+  }
+  catch(...){
+
+    restore(event);
+    throw;
+  }
+
+  return;
+}
+
+void ZprimeVariationEngine::restore(uhh2::Event& event){
+
+  if(!applied_) return;
+
+  if(jets_changed_){
+
+    unsort(*event.jets, jet_order_, jets_dropped_);
+    restore_jet_states(*event.jets, jet_states_);
+  }
+
+  if(topjets_changed_){
+
+    unsort(*event.topjets, topjet_order_, topjets_dropped_);
+    restore_jet_states(*event.topjets, topjet_states_);
+  }
+
+  event.weight = nominal_weight_;
+
+  applied_ = false;
+  jets_changed_    = false;
+  topjets_changed_ = false;
+
+  return;
+}
@@ -0,0 +1,362 @@
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeTTbarReconstruction.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <UHH2/core/include/Utils.h>
+
+#include <UHH2/common/include/ReconstructionHypothesisDiscriminators.h>
+
+namespace {
+
+  /* time-like or light-like, future-pointing: mass-bound of the search valid */
+  bool physical(const LorentzVector& p4){ return p4.M2() >= 0. && p4.E() >= 0.; }
+}
+
+TTbarHypothesisCollector::TTbarHypothesisCollector(const size_t k): items_(k), n_(0) {
+
+  if(!k) throw std::runtime_error("TTbarHypothesisCollector::TTbarHypothesisCollector -- number of hypotheses to be kept must be positive");
+}
+
+void TTbarHypothesisCollector::add(const double chi2, const std::pair<unsigned long long, unsigned long long>& order, const std::vector<int>& jets, const size_t outer){
+
+  TTbarAssignment cand;
+  cand.chi2 = chi2;
+  cand.order = order;
+
+  // position of the new entry (entries beyond the K-th dropped)
+  size_t pos = n_;
+  while(pos > 0 && cand < items_[pos-1]) --pos;
+  if(pos == items_.size()) return;
+
+  if(n_ < items_.size()) ++n_;
+
+  // shift the worse entries (storage of the dropped one reused for the new entry)
+  for(size_t i=n_-1; i>pos; --i) std::swap(items_[i], items_[i-1]);
+
+  TTbarAssignment& item = items_[pos];
+  item.chi2 = chi2;
+  item.order = order;
+  item.jets.assign(jets.begin(), jets.end());
+  item.outer = outer;
+
+  return;
+}
+////////////////////////////////////////////////////////
+
+void TTbarAssignmentSearch::run(const std::vector<LorentzVector>& jets, const LorentzVector& had0, const bool allow_had, const LorentzVector& lep0,
+                                const unsigned long long outer, TTbarHypothesisCollector& best){
+
+  const size_t n = jets.size();
+
+  jets_ = &jets;
+  allow_had_ = allow_had;
+  outer_ = outer;
+
+  suffix_.assign(n+1, LorentzVector());
+  for(size_t k=n; k>0; --k) suffix_[k-1] = suffix_[k] + jets[k-1];
+
+  prune_ = prune_cfg_ && physical(lep0) && (allow_had_ || physical(had0));
+  for(const auto& j : jets) prune_ &= physical(j);
+
+  // code of the assignment as in the exhaustive enumeration: base 3 (had/lep/none), or base 2 (lep/none) if the hadronic side is fixed
+  digits_.assign(n, none);
+  weights_.assign(n, 1);
+  for(size_t k=1; k<n; ++k) weights_[k] = weights_[k-1] * (allow_had_ ? 3 : 2);
+
+  search(0, had0, 0, lep0, 0, 0, best);
+
+  return;
+}
+
+void TTbarAssignmentSearch::search(const size_t k, const LorentzVector& had_v4, const int nhad, const LorentzVector& lep_v4, const int nlep,
+                                   const unsigned long long code, TTbarHypothesisCollector& best){
+
+  ++nodes_;
+
+  const size_t n = jets_->size();
+
+  // complete assignment
+  if(k == n){
+
+    if(!nlep || (allow_had_ && !nhad)) return;
+
+    const double chi2 = chi2_(had_v4, lep_v4);
+    if(chi2 <= best.threshold()) best.add(chi2, std::make_pair(outer_, code), digits_, outer_);
+
+    return;
+  }
+
+  // lower bound of the chi2 of all the completions of the partial assignment
+  const double threshold = best.threshold();
+  if(prune_ && threshold < std::numeric_limits<double>::infinity()){
+
+    const double had_lo = (nhad || !allow_had_) ? TTbarChi2::inv_mass(had_v4) : 0.;
+    const double had_hi = allow_had_ ? TTbarChi2::inv_mass(had_v4 + suffix_[k]) : TTbarChi2::inv_mass(had_v4);
+
+    const double lep_lo = TTbarChi2::inv_mass(lep_v4);
+    const double lep_hi = TTbarChi2::inv_mass(lep_v4 + suffix_[k]);
+
+    const double chi2_lb = TTbarChi2::bound(had_lo, had_hi, chi2_.mass_thad, chi2_.sigma_thad)
+                         + TTbarChi2::bound(lep_lo, lep_hi, chi2_.mass_tlep, chi2_.sigma_tlep);
+
+    // margin for the rounding of the four-vector sums of the bound
+    if(chi2_lb > threshold * (1.+1e-6) + 1e-6) return;
+  }
+
+  const LorentzVector& jet = (*jets_)[k];
+  const unsigned long long w = weights_[k];
+
+  if(allow_had_){
+
+    digits_[k] = had;
+    search(k+1, had_v4 + jet, nhad+1, lep_v4, nlep, code, best);
+  }
+
+  digits_[k] = lep;
+  search(k+1, had_v4, nhad, lep_v4 + jet, nlep+1, code + w, best);
+
+  digits_[k] = none;
+  search(k+1, had_v4, nhad, lep_v4, nlep, code + (allow_had_ ? 2*w : 0), best);
+
+  return;
+}
+////////////////////////////////////////////////////////
+
+BranchBoundTTbarReconstruction::BranchBoundTTbarReconstruction(uhh2::Context& ctx, const NeutrinoReconstructionMethod& neutrinofunction, const std::string& label,
+                                                               const unsigned int max_jets, const size_t top_k, const bool prune):
+  neutrinofunction_(neutrinofunction), max_jets_(max_jets), search_(prune), best_(top_k) {
+
+  h_hyps_    = ctx.declare_event_output<std::vector<ReconstructionHypothesis>>(label);
+  h_primlep_ = ctx.get_handle<FlavorParticle>("PrimaryLepton");
+}
+
+bool BranchBoundTTbarReconstruction::process(uhh2::Event& event){
+
+  assert(event.jets && event.met);
+
+  const Particle& lepton = event.get(h_primlep_);
+  const std::vector<LorentzVector> neutrinos = neutrinofunction_(lepton.v4(), event.met->v4());
+
+  const size_t n_jets = std::min(event.jets->size(), size_t(max_jets_));
+
+  jets_.clear();
+  for(size_t k=0; k<n_jets; ++k) jets_.push_back(event.jets->at(k).v4());
+
+  best_.clear();
+  for(size_t i=0; i<neutrinos.size(); ++i) search_.run(jets_, LorentzVector(), true, lepton.v4() + neutrinos.at(i), i, best_);
+
+  // hypotheses built only for the kept assignments (same four-vector sums as in the exhaustive enumeration)
+  std::vector<ReconstructionHypothesis> hyps;
+  for(size_t h=0; h<best_.size(); ++h){
+
+    const TTbarAssignment& best = best_.at(h);
+    const LorentzVector& neutrino_v4 = neutrinos.at(best.outer);
+
+    LorentzVector tophad_v4;
+    LorentzVector toplep_v4 = lepton.v4() + neutrino_v4;
+
+    ReconstructionHypothesis hyp;
+    hyp.set_lepton(lepton);
+    hyp.set_neutrino_v4(neutrino_v4);
+
+    for(size_t k=0; k<n_jets; ++k){
+
+      if(best.jets[k] == TTbarAssignmentSearch::had){
+
+        tophad_v4 = tophad_v4 + event.jets->at(k).v4();
+        hyp.add_tophad_jet(event.jets->at(k));
+      }
+      else if(best.jets[k] == TTbarAssignmentSearch::lep){
+
+        toplep_v4 = toplep_v4 + event.jets->at(k).v4();
+        hyp.add_toplep_jet(event.jets->at(k));
+      }
+    }
+
+    hyp.set_tophad_v4(tophad_v4);
+    hyp.set_toplep_v4(toplep_v4);
+
+    hyps.push_back(hyp);
+  }
+
+  event.set(h_hyps_, std::move(hyps));
+
+  return true;
+}
+////////////////////////////////////////////////////////
+
+BranchBoundTopTagReconstruction::BranchBoundTopTagReconstruction(uhh2::Context& ctx, const NeutrinoReconstructionMethod& neutrinofunction, const std::string& label,
+                                                                 const TopJetId& topjetID, const float minDR,
+                                                                 const unsigned int max_jets, const size_t top_k, const bool prune):
+  neutrinofunction_(neutrinofunction), topjetID_(topjetID), minDR_(minDR), max_jets_(max_jets), search_(prune), best_(top_k) {
+
+  h_hyps_    = ctx.declare_event_output<std::vector<ReconstructionHypothesis>>(label);
+  h_primlep_ = ctx.get_handle<FlavorParticle>("PrimaryLepton");
+}
+
+bool BranchBoundTopTagReconstruction::process(uhh2::Event& event){
+
+  assert(event.jets && event.topjets && event.met);
+
+  const Particle& lepton = event.get(h_primlep_);
+  const std::vector<LorentzVector> neutrinos = neutrinofunction_(lepton.v4(), event.met->v4());
+
+  std::vector<ReconstructionHypothesis> hyps;
+
+  for(size_t t=0; t<event.topjets->size(); ++t){
+
+    const TopJet& topjet = event.topjets->at(t);
+    if(!topjetID_(topjet, event)) continue;
+
+    // leptonic-side jets: not overlapping with the top-tagged jet
+    jets_.clear();
+    jet_ptrs_.clear();
+    for(const auto& jet : *event.jets){
+
+      if(jets_.size() == max_jets_) break;
+      if(uhh2::deltaR(jet, topjet) > minDR_){
+
+        jets_.push_back(jet.v4());
+        jet_ptrs_.push_back(&jet);
+      }
+    }
+
+    // top-K search per top-tagged jet: hadronic term of the chi2 constant for a given topjet,
+    // ranking of the topjets left to the chi2 discriminator run on the output (Chi2DiscriminatorTTAG)
+    best_.clear();
+    for(size_t i=0; i<neutrinos.size(); ++i) search_.run(jets_, topjet.v4(), false, lepton.v4() + neutrinos.at(i), i, best_);
+
+    for(size_t h=0; h<best_.size(); ++h){
+
+      const TTbarAssignment& best = best_.at(h);
+      const LorentzVector& neutrino_v4 = neutrinos.at(best.outer);
+
+      LorentzVector toplep_v4 = lepton.v4() + neutrino_v4;
+
+      ReconstructionHypothesis hyp;
+      hyp.set_lepton(lepton);
+      hyp.set_neutrino_v4(neutrino_v4);
+      hyp.set_tophad_topjet_ptr(&topjet);
+      hyp.add_tophad_jet(topjet);
+
+      for(size_t k=0; k<jet_ptrs_.size(); ++k){
+
+        if(best.jets[k] != TTbarAssignmentSearch::lep) continue;
+
+        toplep_v4 = toplep_v4 + jet_ptrs_[k]->v4();
+        hyp.add_toplep_jet(*jet_ptrs_[k]);
+      }
+
+      hyp.set_tophad_v4(topjet.v4());
+      hyp.set_toplep_v4(toplep_v4);
+
+      hyps.push_back(hyp);
+    }
+  }
+
+  event.set(h_hyps_, std::move(hyps));
+
+  return true;
+}
+////////////////////////////////////////////////////////
+
+ZprimeTTbarReconstruction::ZprimeTTbarReconstruction(uhh2::Context& ctx, const std::string& label, const std::string& disc, const TopJetId& topjetID, const float minDR_topjet_jet,
+                                                     const std::shared_ptr<DiscriminatorSlots>& slots):
+  disc_(disc), slots_(slots) {
+
+  if(!slots_) throw std::runtime_error("ZprimeTTbarReconstruction::ZprimeTTbarReconstruction -- null pointer to DiscriminatorSlots");
+
+  const std::string& mode = ctx.get("ttbar_reco__mode", "exhaustive");
+  if(mode == "exhaustive"){
+
+    reco_ttag0_.reset(new HighMassTTbarReconstruction(ctx, NeutrinoReconstruction, label));
+    reco_ttag1_.reset(new        TopTagReconstruction(ctx, NeutrinoReconstruction, label, topjetID, minDR_topjet_jet));
+  }
+  else if(mode == "stream" || mode == "bnb"){
+
+    const unsigned int max_jets = std::stoi(ctx.get("ttbar_reco__max_jets", "10"));
+    const unsigned int top_k    = std::stoi(ctx.get("ttbar_reco__top_k"   , "1"));
+    const bool prune(mode == "bnb");
+
+    reco_ttag0_.reset(new  BranchBoundTTbarReconstruction(ctx, NeutrinoReconstruction, label, max_jets, top_k, prune));
+    reco_ttag1_.reset(new BranchBoundTopTagReconstruction(ctx, NeutrinoReconstruction, label, topjetID, minDR_topjet_jet, max_jets, top_k, prune));
+  }
+  else throw std::runtime_error("ZprimeTTbarReconstruction::ZprimeTTbarReconstruction -- undefined argument for 'ttbar_reco__mode' key in xml file (must be 'exhaustive', 'stream' or 'bnb'): "+mode);
+
+  chi2_ttag0_.reset(new Chi2Discriminator    (ctx, label));
+  chi2_ttag1_.reset(new Chi2DiscriminatorTTAG(ctx, label));
+
+  h_hyps_ = ctx.get_handle<std::vector<ReconstructionHypothesis>>(label);
+  h_best_ = ctx.get_handle<BestHypothesis>(best_hypothesis_label(label, disc_));
+
+  slot_chi2_ = slots_->add(disc_);
+  slot_tlep_ = slots_->add(disc_+"_tlep");
+  slot_thad_ = slots_->add(disc_+"_thad");
+}
+
+void ZprimeTTbarReconstruction::process(uhh2::Event& event, const bool toptag){
+
+  if(!toptag){ reco_ttag0_->process(event); chi2_ttag0_->process(event); }
+  else       { reco_ttag1_->process(event); chi2_ttag1_->process(event); }
+
+  // product filled in place (slot values reuse the storage of the previous event)
+  if(!event.is_valid(h_best_)) event.set(h_best_, BestHypothesis());
+  BestHypothesis& best = event.get(h_best_);
+
+  best.hyp   = 0;
+  best.run   = event.run;
+  best.lumi  = event.luminosityBlock;
+  best.event = event.event;
+
+  // chi2 terms of each hypothesis computed from its four-vectors, argmin kept on the fly (first minimum, as get_best_hypothesis)
+  double best_chi2(std::numeric_limits<double>::infinity()), best_tlep(0.), best_thad(0.);
+  for(const auto& hyp : event.get(h_hyps_)){
+
+    LorentzVector tophad_v4;
+    if(toptag){
+
+      const TopJet* topjet = hyp.tophad_topjet_ptr();
+      if(!topjet) throw std::runtime_error("ZprimeTTbarReconstruction::process -- top-tag hypothesis without tophad_topjet_ptr");
+
+      for(const auto& subjet : topjet->subjets()) tophad_v4 += subjet.v4();
+    }
+    else tophad_v4 = hyp.tophad_v4();
+
+    const double chi2_thad = std::pow((TTbarChi2::inv_mass(tophad_v4)       - chi2_.mass_thad) / chi2_.sigma_thad, 2);
+    const double chi2_tlep = std::pow((TTbarChi2::inv_mass(hyp.toplep_v4()) - chi2_.mass_tlep) / chi2_.sigma_tlep, 2);
+
+    if(chi2_thad + chi2_tlep < best_chi2){
+
+      best.hyp  = &hyp;
+      best_chi2 = chi2_thad + chi2_tlep;
+      best_tlep = chi2_tlep;
+      best_thad = chi2_thad;
+    }
+  }
+
+  best.disc.assign(slots_->size(), std::numeric_limits<float>::infinity());
+  if(best.hyp){
+
+    best.disc[slot_chi2_] = best_chi2;
+    best.disc[slot_tlep_] = best_tlep;
+    best.disc[slot_thad_] = best_thad;
+
+    // same value as set by the discriminator module
+    assert(std::abs(best.hyp->discriminator(disc_) - best.disc[slot_chi2_]) <= 1e-3 * (1. + best.disc[slot_chi2_]));
+
+    // slots of discriminators not computed here: string lookup, best hypothesis only
+    for(size_t j=0; j<slots_->size(); ++j){
+
+      if(int(j) == slot_chi2_ || int(j) == slot_tlep_ || int(j) == slot_thad_) continue;
+
+      const std::string& name = slots_->name(j);
+      if(best.hyp->has_discriminator(name)) best.disc[j] = best.hyp->discriminator(name);
+    }
+  }
+
+  return;
+}
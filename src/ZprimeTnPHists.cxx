@@ -0,0 +1,46 @@
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeTnPHists.h>
+
+#include <stdexcept>
+
+TnPEfficiencyHists::TnPEfficiencyHists(uhh2::Context& ctx, const std::string& dirname, const std::vector<std::string>& wps,
+                                       const std::vector<double>& pt_bins, const std::vector<double>& eta_bins, const std::vector<int>& njet_bins,
+                                       const int nmass, const double mass_min, const double mass_max):
+  uhh2::Hists(ctx, dirname), njet_bins_(njet_bins) {
+
+  if(wps.empty())                               throw std::runtime_error("TnPEfficiencyHists::TnPEfficiencyHists -- empty list of working points");
+  if(pt_bins.size() < 2 || eta_bins.size() < 2) throw std::runtime_error("TnPEfficiencyHists::TnPEfficiencyHists -- probe pt and eta binnings need at least 2 edges");
+  if(njet_bins_.empty())                        throw std::runtime_error("TnPEfficiencyHists::TnPEfficiencyHists -- empty jet-multiplicity binning");
+  if(nmass <= 0 || mass_max <= mass_min)        throw std::runtime_error("TnPEfficiencyHists::TnPEfficiencyHists -- invalid M_ZLL binning");
+
+  for(size_t i=1; i<njet_bins_.size(); ++i){
+    if(njet_bins_[i] <= njet_bins_[i-1]) throw std::runtime_error("TnPEfficiencyHists::TnPEfficiencyHists -- jet-multiplicity bin edges must be increasing");
+  }
+
+  std::vector<double> mass_bins(nmass+1);
+  for(int i=0; i<=nmass; ++i) mass_bins[i] = mass_min + (mass_max - mass_min) * i / nmass;
+
+  const std::string title(";probe p_{T} [GeV];probe #eta;M_{ll} [GeV]");
+
+  for(const auto& wp : wps){
+    for(size_t b=0; b<njet_bins_.size(); ++b){
+
+      const std::string njet = "njet"+std::to_string(njet_bins_[b])+(b+1 == njet_bins_.size() ? "plus" : "");
+
+      pass_.push_back(book<TH3F>(wp+"__"+njet+"__pass", title.c_str(), pt_bins.size()-1, pt_bins.data(), eta_bins.size()-1, eta_bins.data(), nmass, mass_bins.data()));
+      fail_.push_back(book<TH3F>(wp+"__"+njet+"__fail", title.c_str(), pt_bins.size()-1, pt_bins.data(), eta_bins.size()-1, eta_bins.data(), nmass, mass_bins.data()));
+    }
+  }
+}
+
+void TnPEfficiencyHists::fill(const size_t wp, const bool pass, const int njets, const float pt, const float eta, const float mass, const double weight){
+
+  if(njets < njet_bins_.front()) return;
+
+  size_t b(njet_bins_.size()-1);
+  while(njets < njet_bins_[b]) --b;
+
+  const size_t i = wp * njet_bins_.size() + b;
+  (pass ? pass_ : fail_).at(i)->Fill(pt, eta, mass, weight);
+
+  return;
+}
@@ -0,0 +1,126 @@
+#include <UHH2/ZprimeSemiLeptonic/include/ZprimeTnPRecord.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include <UHH2/core/include/Utils.h>
+
+namespace {
+
+  TnPRecordFileHeader make_header(const uint64_t nrecords){
+
+    TnPRecordFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "TNPREC", 6);
+    header.version     = TnPRecord::version;
+    header.record_size = sizeof(TnPRecord);
+    header.nrecords    = nrecords;
+
+    return header;
+  }
+}
+
+std::vector<TnPTagDefinition> parse_tnp_tag_definitions(const std::string& cfg, const std::vector<std::string>& jet_wps){
+
+  std::vector<TnPTagDefinition> defs;
+
+  for(const auto& item : uhh2::split(cfg, ",")){
+
+    const auto fields = uhh2::split(item, ":");
+    if(fields.empty() || fields.at(0) == "") throw std::runtime_error("parse_tnp_tag_definitions -- tag definition without name: "+item);
+
+    TnPTagDefinition def;
+    def.name      = fields.at(0);
+    def.use_2dcut = false;
+    def.minDR     = std::numeric_limits<float>::infinity();
+    def.pTrel     = std::numeric_limits<float>::infinity();
+    def.iso       = std::numeric_limits<float>::infinity();
+    def.jet_wp    = 0;
+
+    for(size_t i=1; i<fields.size(); ++i){
+
+      const auto kv = uhh2::split(fields.at(i), "=");
+      if(kv.size() != 2) throw std::runtime_error("parse_tnp_tag_definitions -- invalid field (must be 'key=value'): "+fields.at(i));
+
+      if     (kv.at(0) == "minDR"){ def.minDR = std::stof(kv.at(1)); def.use_2dcut = true; }
+      else if(kv.at(0) == "pTrel"){ def.pTrel = std::stof(kv.at(1)); def.use_2dcut = true; }
+      else if(kv.at(0) == "iso"  ) def.iso   = std::stof(kv.at(1));
+      else if(kv.at(0) == "jets" ){
+
+        const auto it = std::find(jet_wps.begin(), jet_wps.end(), kv.at(1));
+        if(it == jet_wps.end()) throw std::runtime_error("parse_tnp_tag_definitions -- undefined jet working point: "+kv.at(1));
+
+        def.jet_wp = it - jet_wps.begin();
+      }
+      else throw std::runtime_error("parse_tnp_tag_definitions -- undefined key (must be 'minDR', 'pTrel', 'iso' or 'jets'): "+kv.at(0));
+    }
+
+    defs.push_back(def);
+  }
+
+  if(defs.empty()) throw std::runtime_error("parse_tnp_tag_definitions -- empty list of tag definitions");
+
+  return defs;
+}
+////////////////////////////////////////////////////////
+
+std::string tnp_record_file_name(const std::string& prefix, const std::string& dataset){
+
+  if(dataset == "") throw std::runtime_error("tnp_record_file_name -- empty dataset name");
+
+  char host[256];
+  if(::gethostname(host, sizeof(host)) != 0) host[0] = '\0';
+  host[sizeof(host)-1] = '\0';
+
+  return prefix+"."+dataset+"."+std::string(host)+"_"+std::to_string(::getpid())+".tnprec";
+}
+////////////////////////////////////////////////////////
+
+TnPRecordWriter::TnPRecordWriter(const std::string& filename): filename_(filename), file_(0), nrecords_(0) {
+
+  // exclusive creation ('x'): fails if the file already exists
+  file_ = std::fopen(filename_.c_str(), "wbx");
+  if(!file_) throw std::runtime_error("TnPRecordWriter::TnPRecordWriter -- failed to create output file (already existing?): "+filename_);
+
+  // 1 MB output buffer
+  std::setvbuf(file_, 0, _IOFBF, 1 << 20);
+
+  const TnPRecordFileHeader header = make_header(0);
+  if(std::fwrite(&header, sizeof(header), 1, file_) != 1) throw std::runtime_error("TnPRecordWriter::TnPRecordWriter -- failed to write header to file: "+filename_);
+}
+
+TnPRecordWriter::~TnPRecordWriter(){
+
+  try { close(); }
+  catch(const std::exception& e){ std::fprintf(stderr, "%s\n", e.what()); }
+}
+
+void TnPRecordWriter::write(const TnPRecord& record){
+
+  if(!file_) throw std::runtime_error("TnPRecordWriter::write -- file already closed: "+filename_);
+  if(std::fwrite(&record, sizeof(record), 1, file_) != 1) throw std::runtime_error("TnPRecordWriter::write -- failed to write record to file: "+filename_);
+
+  ++nrecords_;
+
+  return;
+}
+
+void TnPRecordWriter::close(){
+
+  if(!file_) return;
+
+  // final number of records in the header
+  const TnPRecordFileHeader header = make_header(nrecords_);
+
+  const bool ok = (std::fseek(file_, 0, SEEK_SET) == 0) && (std::fwrite(&header, sizeof(header), 1, file_) == 1);
+  const bool closed = (std::fclose(file_) == 0);
+  file_ = 0;
+
+  if(!ok || !closed) throw std::runtime_error("TnPRecordWriter::close -- failed to finalize file: "+filename_);
+
+  return;
+}